@@ -3,9 +3,13 @@
 #include "ht.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Hash table entry (slot may be filled or empty).
 typedef struct {
@@ -13,16 +17,62 @@ typedef struct {
     void* value;
 } ht_entry;
 
+// Item in an HT_ORDERED table. Items are stored densely in insertion
+// order, and the hash slots just hold indexes into the items array.
+typedef struct {
+    const char* key;
+    void* value;
+    uint64_t hash;  // saved so expanding doesn't need to rehash keys
+} ht_item;
+
+// Chunk of key storage for HT_ARENA tables. Chunks are never moved or
+// resized, so keys stay put till the table is cleared or destroyed.
+typedef struct ht_chunk {
+    struct ht_chunk* next;  // previous (full) chunk, or NULL
+    size_t size;            // size of data in bytes
+    size_t used;            // bytes of data handed out so far
+    char data[];
+} ht_chunk;
+
+// Hash slot in an HT_COMPACT table. Items live in arena chunks as a
+// record: the value, then the NUL-terminated key, padded to 8 bytes.
+typedef struct {
+    uint32_t offset;  // chunk number and 8-byte unit in it, +1 (0 if empty)
+    uint32_t tag;     // top half of item's hash, compared before the key
+} ht_slot;
+
 // Hash table structure: create with ht_create, free with ht_destroy.
 struct ht {
     ht_entry* entries;  // hash slots
     size_t capacity;    // size of _entries array
     size_t length;      // number of items in hash table
+    uint8_t* epochs;    // slot generations (HT_EPOCH only, else NULL)
+    uint8_t epoch;      // current generation (slots from others are empty)
+    ht_item* items;     // dense items (HT_ORDERED only, else NULL)
+    uint32_t* slots;    // HT_ORDERED hash slots: item index+1, 0 if empty
+    bool keyed;         // true if hashing with SipHash (under attack)
+    uint64_t sip_key[2];  // random per-table key for SipHash
+    bool arena;         // true if keys are stored in chunks (HT_ARENA)
+    ht_chunk* chunks;   // most recent arena chunk first, or NULL
+    uint64_t* filter;   // Bloom filter words (HT_FILTER only, else NULL)
+    ht_slot* compact;   // HT_COMPACT hash slots, else NULL
+    ht_chunk** blocks;  // HT_COMPACT arena chunks, in order of allocation
+    size_t num_blocks;  // number of chunks in blocks
+    uint64_t seed;      // random per-table seed mixed into FNV-1a
 };
 
 #define INITIAL_CAPACITY 16  // must not be zero
 
+// HT_FILTER tables have a Bloom filter of 4 bits per slot, so at least 8
+// bits per item. It's "blocked": both of a key's bits are in the same
+// 64-bit word, so checking it touches a single cache line.
+#define FILTER_WORDS(capacity) ((capacity) / 16)
+
 ht* ht_create(void) {
+    return ht_create_flags(0);
+}
+
+ht* ht_create_flags(int flags) {
     // Allocate space for hash table struct.
     ht* table = malloc(sizeof(ht));
     if (table == NULL) {
@@ -30,34 +80,181 @@ ht* ht_create(void) {
     }
     table->length = 0;
     table->capacity = INITIAL_CAPACITY;
+    table->epochs = NULL;
+    table->epoch = 0;
+    table->items = NULL;
+    table->slots = NULL;
+    table->keyed = false;
+    table->seed = ht_seed();
+    table->arena = (flags & HT_ARENA) != 0;
+    table->chunks = NULL;
+    table->filter = NULL;
+    table->compact = NULL;
+    table->blocks = NULL;
+    table->num_blocks = 0;
+    if (flags & HT_FILTER) {
+        table->filter = calloc(FILTER_WORDS(table->capacity), sizeof(uint64_t));
+        if (table->filter == NULL) {
+            free(table);
+            return NULL;
+        }
+    }
+
+    // Compact tables use small slots and store items in arena chunks
+    // (HT_EPOCH, HT_ORDERED and HT_ARENA don't apply to them).
+    if (flags & HT_COMPACT) {
+        table->entries = NULL;
+        table->compact = calloc(table->capacity, sizeof(ht_slot));
+        if (table->compact == NULL) {
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+        return table;
+    }
+
+    // Ordered tables use an items array and small slots instead of
+    // entries (HT_EPOCH doesn't apply to them).
+    if (flags & HT_ORDERED) {
+        table->entries = NULL;
+        table->items = malloc(table->capacity / 2 * sizeof(ht_item));
+        table->slots = calloc(table->capacity, sizeof(uint32_t));
+        if (table->items == NULL || table->slots == NULL) {
+            free(table->items);
+            free(table->slots);
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+        return table;
+    }
 
     // Allocate (zero'd) space for entry buckets.
     table->entries = calloc(table->capacity, sizeof(ht_entry));
     if (table->entries == NULL) {
+        free(table->filter);
         free(table); // error, free table before we return!
         return NULL;
     }
+
+    // Allocate slot generations if O(1) clear was requested.
+    if (flags & HT_EPOCH) {
+        table->epochs = calloc(table->capacity, sizeof(uint8_t));
+        if (table->epochs == NULL) {
+            free(table->entries);
+            free(table->filter);
+            free(table);
+            return NULL;
+        }
+    }
     return table;
 }
 
-void ht_destroy(ht* table) {
-    // First free allocated keys.
+// Free allocated keys (but not the arrays that hold them).
+static void free_keys(ht* table) {
+    if (table->compact != NULL) {
+        // Keys (and values) all live in the blocks.
+        for (size_t i = 0; i < table->num_blocks; i++) {
+            free(table->blocks[i]);
+        }
+        free(table->blocks);
+        table->blocks = NULL;
+        table->num_blocks = 0;
+        return;
+    }
+    if (table->arena) {
+        // Arena keys all live in the chunks, free those in one go.
+        while (table->chunks != NULL) {
+            ht_chunk* next = table->chunks->next;
+            free(table->chunks);
+            table->chunks = next;
+        }
+        return;
+    }
+    if (table->slots != NULL) {
+        for (size_t i = 0; i < table->length; i++) {
+            free((void*)table->items[i].key);
+        }
+        return;
+    }
     for (size_t i = 0; i < table->capacity; i++) {
         free((void*)table->entries[i].key);
     }
+}
+
+void ht_destroy(ht* table) {
+    // First free allocated keys.
+    free_keys(table);
 
     // Then free entries array and table itself.
     free(table->entries);
+    free(table->epochs);
+    free(table->items);
+    free(table->slots);
+    free(table->filter);
+    free(table->compact);
     free(table);
 }
 
+// Return true if slot at index is empty: never used, or (in an HT_EPOCH
+// table) last used before the most recent ht_clear.
+static inline bool slot_empty(ht* table, size_t index) {
+    return table->entries[index].key == NULL ||
+        (table->epochs != NULL && table->epochs[index] != table->epoch);
+}
+
 #define FNV_OFFSET 14695981039346656037UL
 #define FNV_PRIME 1099511628211UL
 
-// Return 64-bit FNV-1a hash for key (NUL-terminated). See description:
-// https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
-static uint64_t hash_key(const char* key) {
-    uint64_t hash = FNV_OFFSET;
+#define ROTL(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define SIPROUND \
+    do { \
+        v0 += v1; v1 = ROTL(v1, 13); v1 ^= v0; v0 = ROTL(v0, 32); \
+        v2 += v3; v3 = ROTL(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTL(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTL(v1, 17); v1 ^= v2; v2 = ROTL(v2, 32); \
+    } while (0)
+
+// Return 64-bit SipHash-1-3 of key (len bytes) using 128-bit secret k.
+// Words are read in native byte order, which is fine as hashes are
+// never stored or compared across machines. See description:
+// https://en.wikipedia.org/wiki/SipHash
+static uint64_t siphash(const uint64_t k[2], const char* key, size_t len) {
+    uint64_t v0 = k[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k[1] ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k[1] ^ 0x7465646279746573ULL;
+
+    // Compress whole 8-byte words.
+    const char* end = key + (len & ~(size_t)7);
+    for (const char* p = key; p < end; p += 8) {
+        uint64_t m;
+        memcpy(&m, p, 8);
+        v3 ^= m;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    // Last word holds leftover bytes and length.
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < (len & 7); i++) {
+        b |= (uint64_t)(unsigned char)end[i] << (8 * i);
+    }
+    v3 ^= b;
+    SIPROUND;
+    v0 ^= b;
+
+    // Finalize.
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t ht_hash(uint64_t seed, const char* key) {
+    uint64_t hash = FNV_OFFSET ^ seed;
     for (const char* p = key; *p; p++) {
         hash ^= (uint64_t)(unsigned char)(*p);
         hash *= FNV_PRIME;
@@ -65,13 +262,147 @@ static uint64_t hash_key(const char* key) {
     return hash;
 }
 
+uint64_t ht_siphash(const uint64_t k[2], const char* key, size_t len) {
+    return siphash(k, key, len);
+}
+
+// Return 64-bit hash for key (NUL-terminated). This is FNV-1a with the
+// table's random seed mixed in, which is fast and makes slots hard to
+// predict, unless the table has switched to keyed SipHash after seeing
+// a suspiciously long probe. FNV-1a description:
+// https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function
+static uint64_t hash_key(ht* table, const char* key) {
+    if (table->keyed) {
+        return siphash(table->sip_key, key, strlen(key));
+    }
+    return ht_hash(table->seed, key);
+}
+
+// Same as hash_key, but for a string of len bytes (not NUL-terminated).
+static uint64_t hash_len(ht* table, const char* str, size_t len) {
+    if (table->keyed) {
+        return siphash(table->sip_key, str, len);
+    }
+    uint64_t hash = FNV_OFFSET ^ table->seed;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint64_t)(unsigned char)str[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Return true if key (NUL-terminated) equals str (len bytes).
+static inline bool key_equals(const char* key, const char* str, size_t len) {
+    return strncmp(key, str, len) == 0 && key[len] == '\0';
+}
+
+// Switch to SipHash if an insert landed more than this many slots away
+// from its hash's home slot. At most half full, honest linear probing
+// runs are much shorter than this, even in huge tables.
+#define MAX_PROBE_LEN 128
+
+// Return number of slots between home slot for hash and index.
+static inline size_t probe_distance(ht* table, uint64_t hash, size_t index) {
+    return (index - (size_t)hash) & (table->capacity - 1);
+}
+
+// Return mask of the two filter bits for hash, in the filter word picked
+// by the hash's top half (its bottom bits pick the slot). The bits come
+// from a multiplicative remix so they don't depend on the word index.
+static inline uint64_t filter_bits(uint64_t hash) {
+    uint64_t h = hash * 0x9e3779b97f4a7c15ULL;
+    return ((uint64_t)1 << (h >> 58)) | ((uint64_t)1 << ((h >> 52) & 63));
+}
+
+static inline uint64_t* filter_word(ht* table, uint64_t hash) {
+    return &table->filter[(size_t)(hash >> 32) &
+                          (FILTER_WORDS(table->capacity) - 1)];
+}
+
+// Add hash to table's filter (if it has one).
+static inline void filter_add(ht* table, uint64_t hash) {
+    if (table->filter != NULL) {
+        *filter_word(table, hash) |= filter_bits(hash);
+    }
+}
+
+// Return index of the slot referencing key in an HT_ORDERED table, or
+// the index of the empty slot where key belongs if it's not present.
+static size_t ordered_find(ht* table, const char* key, uint64_t hash) {
+    // AND hash with capacity-1 to ensure it's within slots array.
+    size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
+
+    // Loop till we find key or an empty slot.
+    while (table->slots[index] != 0) {
+        ht_item* item = &table->items[table->slots[index] - 1];
+        if (item->hash == hash && strcmp(key, item->key) == 0) {
+            break;
+        }
+        index++;
+        if (index >= table->capacity) {
+            index = 0;
+        }
+    }
+    return index;
+}
+
+// HT_COMPACT slot offsets address 8-byte units in chunks of at most
+// 1 << BLOCK_BITS units (MAX_CHUNK_SIZE), with the chunk number in the
+// remaining bits. That's room for 32GB of keys and values.
+#define BLOCK_BITS 17
+#define MAX_BLOCKS (((size_t)1 << (32 - BLOCK_BITS)) - 1)
+
+// Return record (value, then key) for HT_COMPACT slot offset.
+static inline char* compact_record(ht* table, uint32_t offset) {
+    offset--;
+    return table->blocks[offset >> BLOCK_BITS]->data +
+        (size_t)(offset & ((1 << BLOCK_BITS) - 1)) * 8;
+}
+
+// Return index of the slot referencing key in an HT_COMPACT table, or
+// the index of the empty slot where key belongs if it's not present.
+static size_t compact_find(ht* table, const char* key, uint64_t hash) {
+    // AND hash with capacity-1 to ensure it's within slots array.
+    uint32_t tag = (uint32_t)(hash >> 32);
+    size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
+
+    // Loop till we find key or an empty slot.
+    while (table->compact[index].offset != 0) {
+        ht_slot slot = table->compact[index];
+        if (slot.tag == tag &&
+                strcmp(key, compact_record(table, slot.offset) + 8) == 0) {
+            break;
+        }
+        index++;
+        if (index >= table->capacity) {
+            index = 0;
+        }
+    }
+    return index;
+}
+
 void* ht_get(ht* table, const char* key) {
     // AND hash with capacity-1 to ensure it's within entries array.
-    uint64_t hash = hash_key(key);
+    uint64_t hash = hash_key(table, key);
+    if (table->filter != NULL) {
+        // If either of key's filter bits is clear, it's definitely absent.
+        uint64_t bits = filter_bits(hash);
+        if ((*filter_word(table, hash) & bits) != bits) {
+            return NULL;
+        }
+    }
+    if (table->slots != NULL) {
+        uint32_t n = table->slots[ordered_find(table, key, hash)];
+        return n != 0 ? table->items[n - 1].value : NULL;
+    }
+    if (table->compact != NULL) {
+        uint32_t offset = table->compact[compact_find(table, key, hash)].offset;
+        return offset != 0 ? *(void**)compact_record(table, offset) : NULL;
+    }
     size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
 
     // Loop till we find an empty entry.
-    while (table->entries[index].key != NULL) {
+    while (!slot_empty(table, index)) {
         if (strcmp(key, table->entries[index].key) == 0) {
             // Found key, return value.
             return table->entries[index].value;
@@ -86,15 +417,138 @@ void* ht_get(ht* table, const char* key) {
     return NULL;
 }
 
+static bool ht_rekey(ht* table);
+
+#define MIN_CHUNK_SIZE 4096
+#define MAX_CHUNK_SIZE (1024 * 1024)
+
+// Allocate size bytes from table's arena, adding a chunk if the current
+// one is full. Chunks double in size up to MAX_CHUNK_SIZE. Return NULL
+// if out of memory.
+static char* arena_alloc(ht* table, size_t size) {
+    ht_chunk* head = table->chunks;
+    if (head != NULL && head->size - head->used >= size) {
+        char* p = head->data + head->used;
+        head->used += size;
+        return p;
+    }
+
+    size_t chunk_size = head != NULL ? head->size * 2 : MIN_CHUNK_SIZE;
+    if (chunk_size > MAX_CHUNK_SIZE) {
+        chunk_size = MAX_CHUNK_SIZE;
+    }
+    if (size > chunk_size / 4) {
+        // Large key gets a chunk to itself, linked in behind the head so
+        // the head's free space is still used for later keys.
+        ht_chunk* chunk = malloc(sizeof(ht_chunk) + size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->size = size;
+        chunk->used = size;
+        if (head == NULL) {
+            chunk->next = NULL;
+            table->chunks = chunk;
+        } else {
+            chunk->next = head->next;
+            head->next = chunk;
+        }
+        return chunk->data;
+    }
+
+    ht_chunk* chunk = malloc(sizeof(ht_chunk) + chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = head;
+    chunk->size = chunk_size;
+    chunk->used = size;
+    table->chunks = chunk;
+    return chunk->data;
+}
+
+// Allocate a record of size bytes (a multiple of 8) in an HT_COMPACT
+// table's blocks and set *poffset to its slot offset. Return NULL if out
+// of memory or the blocks are full.
+static char* compact_alloc(ht* table, size_t size, uint32_t* poffset) {
+    ht_chunk* head = NULL;
+    if (table->num_blocks > 0) {
+        head = table->blocks[table->num_blocks - 1];
+        if (head->size - head->used >= size) {
+            *poffset = (uint32_t)(((table->num_blocks - 1) << BLOCK_BITS) |
+                                  (head->used / 8)) + 1;
+            char* p = head->data + head->used;
+            head->used += size;
+            return p;
+        }
+    }
+
+    // Add new chunk (larger than MAX_CHUNK_SIZE for a huge key, which
+    // is fine as offsets only address the start of a record).
+    if (table->num_blocks >= MAX_BLOCKS) {
+        return NULL;
+    }
+    size_t chunk_size = head != NULL ? head->size * 2 : MIN_CHUNK_SIZE;
+    if (chunk_size > MAX_CHUNK_SIZE) {
+        chunk_size = MAX_CHUNK_SIZE;
+    }
+    if (size > chunk_size) {
+        chunk_size = size;
+    }
+    size_t n = table->num_blocks;
+    if ((n & (n - 1)) == 0) {
+        // Number of blocks is zero or a power of two, double the array.
+        ht_chunk** blocks = realloc(table->blocks,
+                                    (n == 0 ? 1 : n * 2) * sizeof(ht_chunk*));
+        if (blocks == NULL) {
+            return NULL;
+        }
+        table->blocks = blocks;
+    }
+    ht_chunk* chunk = malloc(sizeof(ht_chunk) + chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = chunk_size;
+    chunk->used = size;
+    table->blocks[n] = chunk;
+    table->num_blocks++;
+    *poffset = (uint32_t)(n << BLOCK_BITS) + 1;
+    return chunk->data;
+}
+
+// Return size of HT_COMPACT record for a key of len bytes: 8 bytes for
+// the value, plus key and NUL rounded up to 8 bytes.
+static inline size_t record_size(size_t len) {
+    return 8 + ((len + 8) & ~(size_t)7);
+}
+
+// Copy key (len bytes, plus a NUL terminator) into the table's arena, or
+// newly allocated memory if it doesn't have one. Return NULL if out of
+// memory.
+static char* copy_key(ht* table, const char* key, size_t len) {
+    char* copy = table->arena ? arena_alloc(table, len + 1)
+                              : malloc(len + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    memcpy(copy, key, len);
+    copy[len] = '\0';
+    return copy;
+}
+
 // Internal function to set an entry (without expanding table).
-static const char* ht_set_entry(ht_entry* entries, size_t capacity,
-        const char* key, void* value, size_t* plength) {
+static const char* ht_set_entry(ht* table, const char* key, void* value,
+        size_t* plength) {
     // AND hash with capacity-1 to ensure it's within entries array.
-    uint64_t hash = hash_key(key);
+    ht_entry* entries = table->entries;
+    size_t capacity = table->capacity;
+    uint64_t hash = hash_key(table, key);
     size_t index = (size_t)(hash & (uint64_t)(capacity - 1));
 
     // Loop till we find an empty entry.
-    while (entries[index].key != NULL) {
+    while (!slot_empty(table, index)) {
         if (strcmp(key, entries[index].key) == 0) {
             // Found key (it already exists), update value.
             entries[index].value = value;
@@ -110,43 +564,359 @@ static const char* ht_set_entry(ht_entry* entries, size_t capacity,
 
     // Didn't find key, allocate+copy if needed, then insert it.
     if (plength != NULL) {
-        key = strdup(key);
+        key = copy_key(table, key, strlen(key));
         if (key == NULL) {
             return NULL;
         }
         (*plength)++;
     }
+    if (table->epochs != NULL) {
+        // Slot may hold a key from an earlier generation, free it.
+        if (!table->arena) {
+            free((void*)entries[index].key);
+        }
+        table->epochs[index] = table->epoch;
+    }
     entries[index].key = (char*)key;
     entries[index].value = value;
+    filter_add(table, hash);
+
+    // A very long probe is likely a collision attack, so rehash with
+    // SipHash (if that fails, the item is still set).
+    if (plength != NULL && !table->keyed &&
+            probe_distance(table, hash, index) > MAX_PROBE_LEN) {
+        ht_rekey(table);
+    }
+    return key;
+}
+
+// Internal function to set an item in an HT_ORDERED table (without
+// expanding table). New items are appended to the items array.
+static const char* ordered_set(ht* table, const char* key, void* value) {
+    uint64_t hash = hash_key(table, key);
+    size_t index = ordered_find(table, key, hash);
+    if (table->slots[index] != 0) {
+        // Found key (it already exists), update value.
+        ht_item* item = &table->items[table->slots[index] - 1];
+        item->value = value;
+        return item->key;
+    }
+
+    // Didn't find key, copy it and append new item.
+    key = copy_key(table, key, strlen(key));
+    if (key == NULL) {
+        return NULL;
+    }
+    ht_item* item = &table->items[table->length];
+    item->key = key;
+    item->value = value;
+    item->hash = hash;
+    table->length++;
+    table->slots[index] = (uint32_t)table->length;
+    filter_add(table, hash);
+
+    // Rehash with SipHash if the probe was suspiciously long.
+    if (!table->keyed && probe_distance(table, hash, index) > MAX_PROBE_LEN) {
+        ht_rekey(table);
+    }
     return key;
 }
 
+// Internal function to set an item in an HT_COMPACT table (without
+// expanding table). New items are appended to the last block.
+static const char* compact_set(ht* table, const char* key, void* value) {
+    uint64_t hash = hash_key(table, key);
+    size_t index = compact_find(table, key, hash);
+    if (table->compact[index].offset != 0) {
+        // Found key (it already exists), update value.
+        char* record = compact_record(table, table->compact[index].offset);
+        *(void**)record = value;
+        return record + 8;
+    }
+
+    // Didn't find key, copy it and its value to a new record.
+    size_t len = strlen(key);
+    uint32_t offset;
+    char* record = compact_alloc(table, record_size(len), &offset);
+    if (record == NULL) {
+        return NULL;
+    }
+    *(void**)record = value;
+    memcpy(record + 8, key, len + 1);
+    table->compact[index].offset = offset;
+    table->compact[index].tag = (uint32_t)(hash >> 32);
+    table->length++;
+    filter_add(table, hash);
+
+    // Rehash with SipHash if the probe was suspiciously long.
+    if (!table->keyed && probe_distance(table, hash, index) > MAX_PROBE_LEN) {
+        ht_rekey(table);
+    }
+    return record + 8;
+}
+
+// Resize HT_COMPACT table to new_capacity slots. Hashes aren't stored
+// in full, so keys are rehashed, but they're read from the blocks in
+// order rather than at random.
+static bool compact_resize(ht* table, size_t new_capacity) {
+    ht_slot* new_slots = calloc(new_capacity, sizeof(ht_slot));
+    if (new_slots == NULL) {
+        return false;
+    }
+    uint64_t* new_filter = NULL;
+    if (table->filter != NULL) {
+        new_filter = calloc(FILTER_WORDS(new_capacity), sizeof(uint64_t));
+        if (new_filter == NULL) {
+            free(new_slots);
+            return false;
+        }
+    }
+    free(table->compact);
+    free(table->filter);
+    table->compact = new_slots;
+    table->filter = new_filter;
+    table->capacity = new_capacity;
+
+    // Walk records in each block, pointing new slots at them.
+    for (size_t b = 0; b < table->num_blocks; b++) {
+        ht_chunk* chunk = table->blocks[b];
+        size_t pos = 0;
+        while (pos < chunk->used) {
+            const char* key = chunk->data + pos + 8;
+            uint64_t hash = hash_key(table, key);
+            size_t index = (size_t)(hash & (uint64_t)(new_capacity - 1));
+            while (new_slots[index].offset != 0) {
+                index++;
+                if (index >= new_capacity) {
+                    index = 0;
+                }
+            }
+            new_slots[index].offset = (uint32_t)((b << BLOCK_BITS) |
+                                                 (pos / 8)) + 1;
+            new_slots[index].tag = (uint32_t)(hash >> 32);
+            filter_add(table, hash);
+            pos += record_size(strlen(key));
+        }
+    }
+    return true;
+}
+
+// Resize HT_ORDERED table to new_capacity slots. Items stay where they
+// are (the array is just grown), only the slots are rebuilt.
+static bool ordered_resize(ht* table, size_t new_capacity) {
+    if (new_capacity / 2 > UINT32_MAX) {
+        return false;  // item indexes wouldn't fit in slots
+    }
+    uint32_t* new_slots = calloc(new_capacity, sizeof(uint32_t));
+    if (new_slots == NULL) {
+        return false;
+    }
+    uint64_t* new_filter = NULL;
+    if (table->filter != NULL) {
+        new_filter = calloc(FILTER_WORDS(new_capacity), sizeof(uint64_t));
+        if (new_filter == NULL) {
+            free(new_slots);
+            return false;
+        }
+    }
+    ht_item* new_items = realloc(table->items,
+                                 new_capacity / 2 * sizeof(ht_item));
+    if (new_items == NULL) {
+        free(new_slots);
+        free(new_filter);
+        return false;
+    }
+    table->items = new_items;
+
+    // Point new slots at items, using saved hashes.
+    for (size_t i = 0; i < table->length; i++) {
+        size_t index = (size_t)(new_items[i].hash &
+                                (uint64_t)(new_capacity - 1));
+        while (new_slots[index] != 0) {
+            index++;
+            if (index >= new_capacity) {
+                index = 0;
+            }
+        }
+        new_slots[index] = (uint32_t)(i + 1);
+    }
+
+    free(table->slots);
+    table->slots = new_slots;
+    table->capacity = new_capacity;
+
+    // Rebuild filter (if any) from saved hashes too.
+    if (new_filter != NULL) {
+        free(table->filter);
+        table->filter = new_filter;
+        for (size_t i = 0; i < table->length; i++) {
+            filter_add(table, new_items[i].hash);
+        }
+    }
+    return true;
+}
+
+// Resize hash table to new_capacity slots (a power of two greater than
+// twice its length), rehashing all items. Return true on success, false
+// if out of memory.
+static bool ht_resize(ht* table, size_t new_capacity) {
+    if (table->slots != NULL) {
+        return ordered_resize(table, new_capacity);
+    }
+    if (table->compact != NULL) {
+        return compact_resize(table, new_capacity);
+    }
+
+    // Allocate new entries array.
+    ht_entry* new_entries = calloc(new_capacity, sizeof(ht_entry));
+    if (new_entries == NULL) {
+        return false;
+    }
+    uint8_t* new_epochs = NULL;
+    if (table->epochs != NULL) {
+        new_epochs = calloc(new_capacity, sizeof(uint8_t));
+        if (new_epochs == NULL) {
+            free(new_entries);
+            return false;
+        }
+    }
+    uint64_t* new_filter = NULL;
+    if (table->filter != NULL) {
+        new_filter = calloc(FILTER_WORDS(new_capacity), sizeof(uint64_t));
+        if (new_filter == NULL) {
+            free(new_entries);
+            free(new_epochs);
+            return false;
+        }
+    }
+
+    // Switch table to new arrays, keeping hold of the old ones.
+    ht_entry* old_entries = table->entries;
+    uint8_t* old_epochs = table->epochs;
+    size_t old_capacity = table->capacity;
+    table->entries = new_entries;
+    table->epochs = new_epochs;
+    table->capacity = new_capacity;
+
+    // Reinserting items fills in the new filter.
+    free(table->filter);
+    table->filter = new_filter;
+
+    // Iterate entries, move all non-empty ones to new table's entries.
+    for (size_t i = 0; i < old_capacity; i++) {
+        ht_entry entry = old_entries[i];
+        if (entry.key == NULL) {
+            continue;
+        }
+        if (old_epochs != NULL && old_epochs[i] != table->epoch) {
+            if (!table->arena) {
+                free((void*)entry.key);  // left over from before ht_clear
+            }
+            continue;
+        }
+        ht_set_entry(table, entry.key, entry.value, NULL);
+    }
+
+    // Free old arrays.
+    free(old_entries);
+    free(old_epochs);
+    return true;
+}
+
 // Expand hash table to twice its current size. Return true on success,
 // false if out of memory.
 static bool ht_expand(ht* table) {
-    // Allocate new entries array.
     size_t new_capacity = table->capacity * 2;
     if (new_capacity < table->capacity) {
         return false;  // overflow (capacity would be too big)
     }
-    ht_entry* new_entries = calloc(new_capacity, sizeof(ht_entry));
-    if (new_entries == NULL) {
-        return false;
+    return ht_resize(table, new_capacity);
+}
+
+void ht_random_key(uint64_t key[2]) {
+    FILE* f = fopen("/dev/urandom", "rb");
+    if (f != NULL) {
+        size_t n = fread(key, sizeof(uint64_t), 2, f);
+        fclose(f);
+        if (n == 2) {
+            return;
+        }
     }
+    uint64_t k[2] = {(uint64_t)time(NULL), (uint64_t)clock()};
+    key[0] = siphash(k, (const char*)&key, sizeof(uint64_t*));
+    key[1] = siphash(k, (const char*)&k, sizeof(k));
+}
 
-    // Iterate entries, move all non-empty ones to new table's entries.
-    for (size_t i = 0; i < table->capacity; i++) {
-        ht_entry entry = table->entries[i];
-        if (entry.key != NULL) {
-            ht_set_entry(new_entries, new_capacity, entry.key,
-                         entry.value, NULL);
+// Secret for deriving table seeds, read from /dev/urandom once, or
+// the fixed seed from HT_SEED. If two threads race to set them, either's
+// values are fine.
+static _Atomic uint64_t seed_key[2];
+static _Atomic uint64_t fixed_seed;
+static atomic_bool seed_fixed;
+static atomic_bool seeds_set;
+static _Atomic uint64_t num_seeds;
+
+// Read HT_SEED, or if it's not set, the random secret. HT_SEED must be a
+// whole number (decimal, or hex starting with 0x); anything else is
+// ignored, so a malformed value can't quietly turn seeding off.
+static void init_seeds(void) {
+    const char* env = getenv("HT_SEED");
+    if (env != NULL && *env >= '0' && *env <= '9') {
+        char* end;
+        errno = 0;
+        unsigned long long seed = strtoull(env, &end, 0);
+        if (*end == '\0' && errno == 0) {
+            atomic_store(&fixed_seed, (uint64_t)seed);
+            atomic_store(&seed_fixed, true);
+            atomic_store(&seeds_set, true);
+            return;
         }
     }
+    uint64_t key[2];
+    ht_random_key(key);
+    atomic_store(&seed_key[0], key[0]);
+    atomic_store(&seed_key[1], key[1]);
+    atomic_store(&seeds_set, true);
+}
 
-    // Free old entries array and update this table's details.
-    free(table->entries);
-    table->entries = new_entries;
-    table->capacity = new_capacity;
+uint64_t ht_seed(void) {
+    if (!atomic_load(&seeds_set)) {
+        init_seeds();
+    }
+    if (atomic_load(&seed_fixed)) {
+        return atomic_load(&fixed_seed);
+    }
+
+    // Hash a counter with the secret, which is much cheaper than
+    // reading /dev/urandom for every table.
+    uint64_t key[2] = {atomic_load(&seed_key[0]), atomic_load(&seed_key[1])};
+    uint64_t n = atomic_fetch_add(&num_seeds, 1);
+    return siphash(key, (const char*)&n, sizeof(n));
+}
+
+// Switch table to SipHash with a new random key and rehash all items in
+// place (capacity is unchanged). Called when an insert has to probe so
+// far that the keys were likely chosen to collide (despite the seed, for
+// example if it's been pinned with HT_SEED). Return true on
+// success, false if out of memory (table keeps using FNV-1a).
+static bool ht_rekey(ht* table) {
+    table->keyed = true;
+    ht_random_key(table->sip_key);
+    if (table->slots != NULL) {
+        for (size_t i = 0; i < table->length; i++) {
+            table->items[i].hash = hash_key(table, table->items[i].key);
+        }
+    }
+    if (!ht_resize(table, table->capacity)) {
+        // Slots still use FNV-1a, so go back to that.
+        table->keyed = false;
+        if (table->slots != NULL) {
+            for (size_t i = 0; i < table->length; i++) {
+                table->items[i].hash = hash_key(table, table->items[i].key);
+            }
+        }
+        return false;
+    }
     return true;
 }
 
@@ -164,28 +934,531 @@ const char* ht_set(ht* table, const char* key, void* value) {
     }
 
     // Set entry and update length.
-    return ht_set_entry(table->entries, table->capacity, key, value,
-                        &table->length);
+    if (table->slots != NULL) {
+        return ordered_set(table, key, value);
+    }
+    if (table->compact != NULL) {
+        return compact_set(table, key, value);
+    }
+    return ht_set_entry(table, key, value, &table->length);
+}
+
+const char* ht_intern(ht* table, const char* str, size_t len) {
+    // If length will exceed half of current capacity, expand it.
+    if (table->length >= table->capacity / 2) {
+        if (!ht_expand(table)) {
+            return NULL;
+        }
+    }
+
+    // AND hash with capacity-1 to ensure it's within slots/entries.
+    uint64_t hash = hash_len(table, str, len);
+    size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
+    char* key;
+    if (table->slots != NULL) {
+        // Loop till we find str or an empty slot.
+        while (table->slots[index] != 0) {
+            ht_item* item = &table->items[table->slots[index] - 1];
+            if (item->hash == hash && key_equals(item->key, str, len)) {
+                return item->key;
+            }
+            index++;
+            if (index >= table->capacity) {
+                index = 0;
+            }
+        }
+
+        // Didn't find it, copy str and append new item.
+        key = copy_key(table, str, len);
+        if (key == NULL) {
+            return NULL;
+        }
+        ht_item* item = &table->items[table->length];
+        item->key = key;
+        item->value = key;
+        item->hash = hash;
+        table->length++;
+        table->slots[index] = (uint32_t)table->length;
+    } else if (table->compact != NULL) {
+        // Loop till we find str or an empty slot.
+        uint32_t tag = (uint32_t)(hash >> 32);
+        while (table->compact[index].offset != 0) {
+            ht_slot slot = table->compact[index];
+            if (slot.tag == tag) {
+                char* record = compact_record(table, slot.offset);
+                if (key_equals(record + 8, str, len)) {
+                    return record + 8;
+                }
+            }
+            index++;
+            if (index >= table->capacity) {
+                index = 0;
+            }
+        }
+
+        // Didn't find it, copy str to a new record (its own value).
+        uint32_t offset;
+        char* record = compact_alloc(table, record_size(len), &offset);
+        if (record == NULL) {
+            return NULL;
+        }
+        key = record + 8;
+        memcpy(key, str, len);
+        key[len] = '\0';
+        *(void**)record = key;
+        table->compact[index].offset = offset;
+        table->compact[index].tag = tag;
+        table->length++;
+    } else {
+        // Loop till we find str or an empty entry.
+        ht_entry* entries = table->entries;
+        while (!slot_empty(table, index)) {
+            if (key_equals(entries[index].key, str, len)) {
+                return entries[index].key;
+            }
+            index++;
+            if (index >= table->capacity) {
+                index = 0;
+            }
+        }
+
+        // Didn't find it, copy str and insert it.
+        key = copy_key(table, str, len);
+        if (key == NULL) {
+            return NULL;
+        }
+        if (table->epochs != NULL) {
+            if (!table->arena) {
+                free((void*)entries[index].key);
+            }
+            table->epochs[index] = table->epoch;
+        }
+        entries[index].key = key;
+        entries[index].value = key;
+        table->length++;
+    }
+    filter_add(table, hash);
+
+    // Rehash with SipHash if the probe was suspiciously long.
+    if (!table->keyed && probe_distance(table, hash, index) > MAX_PROBE_LEN) {
+        ht_rekey(table);
+    }
+    return key;
 }
 
 size_t ht_length(ht* table) {
     return table->length;
 }
 
+size_t ht_memory(ht* table) {
+    size_t capacity = table->capacity;
+    size_t bytes = sizeof(ht);
+    if (table->entries != NULL) {
+        bytes += capacity * sizeof(ht_entry);
+    }
+    if (table->epochs != NULL) {
+        bytes += capacity * sizeof(uint8_t);
+    }
+    if (table->items != NULL) {
+        bytes += capacity / 2 * sizeof(ht_item) + capacity * sizeof(uint32_t);
+    }
+    if (table->compact != NULL) {
+        bytes += capacity * sizeof(ht_slot);
+    }
+    if (table->filter != NULL) {
+        bytes += FILTER_WORDS(capacity) * sizeof(uint64_t);
+    }
+
+    // Add key storage: chunks, or each allocated key.
+    if (table->compact != NULL) {
+        size_t n = 1;
+        while (n < table->num_blocks) {
+            n *= 2;
+        }
+        bytes += table->num_blocks > 0 ? n * sizeof(ht_chunk*) : 0;
+        for (size_t i = 0; i < table->num_blocks; i++) {
+            bytes += sizeof(ht_chunk) + table->blocks[i]->size;
+        }
+    } else if (table->arena) {
+        for (ht_chunk* chunk = table->chunks; chunk != NULL;
+                chunk = chunk->next) {
+            bytes += sizeof(ht_chunk) + chunk->size;
+        }
+    } else if (table->slots != NULL) {
+        for (size_t i = 0; i < table->length; i++) {
+            bytes += strlen(table->items[i].key) + 1;
+        }
+    } else {
+        for (size_t i = 0; i < capacity; i++) {
+            if (table->entries[i].key != NULL) {
+                bytes += strlen(table->entries[i].key) + 1;
+            }
+        }
+    }
+    return bytes;
+}
+
+bool ht_reserve(ht* table, size_t num_items) {
+    // Tables expand when they get half full, so double capacity till
+    // num_items is at most half of it.
+    size_t new_capacity = table->capacity;
+    while (new_capacity / 2 < num_items) {
+        new_capacity *= 2;
+        if (new_capacity == 0) {
+            return false;  // overflow (capacity would be too big)
+        }
+    }
+    if (new_capacity == table->capacity) {
+        return true;
+    }
+    return ht_resize(table, new_capacity);
+}
+
+ht* ht_create_like(ht* table) {
+    int flags = 0;
+    if (table->epochs != NULL) {
+        flags |= HT_EPOCH;
+    }
+    if (table->slots != NULL) {
+        flags |= HT_ORDERED;
+    }
+    if (table->arena) {
+        flags |= HT_ARENA;
+    }
+    if (table->filter != NULL) {
+        flags |= HT_FILTER;
+    }
+    if (table->compact != NULL) {
+        flags |= HT_COMPACT;
+    }
+    ht* like = ht_create_flags(flags);
+    if (like == NULL) {
+        return NULL;
+    }
+
+    // Use the same hash function, so the new table doesn't have to
+    // detect an attack all over again, and merges can reuse hashes.
+    like->keyed = table->keyed;
+    like->seed = table->seed;
+    like->sip_key[0] = table->sip_key[0];
+    like->sip_key[1] = table->sip_key[1];
+    return like;
+}
+
+ht* ht_copy(ht* table) {
+    ht* copy = ht_create_like(table);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    // Size copy up front, then insert items (in order, if ordered).
+    if (!ht_reserve(copy, table->length)) {
+        ht_destroy(copy);
+        return NULL;
+    }
+    hti it = ht_iterator(table);
+    while (ht_next(&it)) {
+        if (ht_set(copy, it.key, it.value) == NULL) {
+            ht_destroy(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+// Merge one item from src into dst. hash must be key's hash in dst. If
+// move is true, a key new to dst is taken over rather than copied.
+// Return dst's key, or NULL if out of memory.
+static const char* merge_item(ht* dst, const char* key, uint64_t hash,
+        void* value, ht_combine_func combine, void* arg, bool move) {
+    // If length will exceed half of current capacity, expand it.
+    if (dst->length >= dst->capacity / 2) {
+        if (!ht_expand(dst)) {
+            return NULL;
+        }
+    }
+
+    size_t index;
+    if (dst->slots != NULL) {
+        index = ordered_find(dst, key, hash);
+        if (dst->slots[index] != 0) {
+            ht_item* item = &dst->items[dst->slots[index] - 1];
+            item->value = combine != NULL ?
+                combine(item->key, item->value, value, arg) : value;
+            assert(item->value != NULL);
+            return item->key;
+        }
+        if (!move) {
+            key = copy_key(dst, key, strlen(key));
+            if (key == NULL) {
+                return NULL;
+            }
+        }
+        ht_item* item = &dst->items[dst->length];
+        item->key = key;
+        item->value = value;
+        item->hash = hash;
+        dst->length++;
+        dst->slots[index] = (uint32_t)dst->length;
+    } else if (dst->compact != NULL) {
+        index = compact_find(dst, key, hash);
+        if (dst->compact[index].offset != 0) {
+            char* record = compact_record(dst, dst->compact[index].offset);
+            void** pvalue = (void**)record;
+            *pvalue = combine != NULL ?
+                combine(record + 8, *pvalue, value, arg) : value;
+            assert(*pvalue != NULL);
+            return record + 8;
+        }
+        size_t len = strlen(key);
+        uint32_t offset;
+        char* record = compact_alloc(dst, record_size(len), &offset);
+        if (record == NULL) {
+            return NULL;
+        }
+        *(void**)record = value;
+        memcpy(record + 8, key, len + 1);
+        key = record + 8;
+        dst->compact[index].offset = offset;
+        dst->compact[index].tag = (uint32_t)(hash >> 32);
+        dst->length++;
+    } else {
+        ht_entry* entries = dst->entries;
+        index = (size_t)(hash & (uint64_t)(dst->capacity - 1));
+        while (!slot_empty(dst, index)) {
+            if (strcmp(key, entries[index].key) == 0) {
+                entries[index].value = combine != NULL ?
+                    combine(entries[index].key, entries[index].value,
+                            value, arg) : value;
+                assert(entries[index].value != NULL);
+                return entries[index].key;
+            }
+            index++;
+            if (index >= dst->capacity) {
+                index = 0;
+            }
+        }
+        if (!move) {
+            key = copy_key(dst, key, strlen(key));
+            if (key == NULL) {
+                return NULL;
+            }
+        }
+        if (dst->epochs != NULL) {
+            if (!dst->arena) {
+                free((void*)entries[index].key);
+            }
+            dst->epochs[index] = dst->epoch;
+        }
+        entries[index].key = key;
+        entries[index].value = value;
+        dst->length++;
+    }
+    filter_add(dst, hash);
+
+    // Rehash with SipHash if the probe was suspiciously long.
+    if (!dst->keyed && probe_distance(dst, hash, index) > MAX_PROBE_LEN) {
+        ht_rekey(dst);
+    }
+    return key;
+}
+
+// Return true if table a hashes keys the same way as table b.
+static inline bool same_hash(ht* a, ht* b) {
+    if (a->keyed != b->keyed) {
+        return false;
+    }
+    if (!a->keyed) {
+        return a->seed == b->seed;
+    }
+    return a->sip_key[0] == b->sip_key[0] && a->sip_key[1] == b->sip_key[1];
+}
+
+// Implement ht_merge and ht_merge_move (in which case src is about to be
+// destroyed, so its keys can be moved to dst).
+static bool merge(ht* dst, ht* src, ht_combine_func combine, void* arg,
+        bool move) {
+    assert(dst != src);
+
+    // Grow dst up front to fit at least as many items as the larger
+    // table. If the keys overlap a lot, that's all it needs (reserving
+    // for both tables' items would double its size for nothing).
+    size_t num_items = dst->length > src->length ? dst->length : src->length;
+    if (!ht_reserve(dst, num_items)) {
+        return false;
+    }
+
+    // Keys can only be moved between tables that malloc each key.
+    move = move && !src->arena && src->compact == NULL &&
+        !dst->arena && dst->compact == NULL;
+
+    // Ordered tables have saved hashes, which are reused if dst hashes
+    // keys the same way (it may switch to SipHash partway through).
+    if (src->slots != NULL) {
+        for (size_t i = 0; i < src->length; i++) {
+            ht_item* item = &src->items[i];
+            uint64_t hash = same_hash(dst, src) ? item->hash
+                                                : hash_key(dst, item->key);
+            const char* key = merge_item(dst, item->key, hash, item->value,
+                                         combine, arg, move);
+            if (key == NULL) {
+                return false;
+            }
+            if (key == item->key) {
+                item->key = NULL;  // moved to dst, so src mustn't free it
+            }
+        }
+        return true;
+    }
+    if (src->compact != NULL) {
+        for (size_t i = 0; i < src->capacity; i++) {
+            uint32_t offset = src->compact[i].offset;
+            if (offset == 0) {
+                continue;
+            }
+            char* record = compact_record(src, offset);
+            uint64_t hash = hash_key(dst, record + 8);
+            if (merge_item(dst, record + 8, hash, *(void**)record,
+                           combine, arg, false) == NULL) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (size_t i = 0; i < src->capacity; i++) {
+        if (slot_empty(src, i)) {
+            continue;
+        }
+        ht_entry* entry = &src->entries[i];
+        uint64_t hash = hash_key(dst, entry->key);
+        const char* key = merge_item(dst, entry->key, hash, entry->value,
+                                     combine, arg, move);
+        if (key == NULL) {
+            return false;
+        }
+        if (key == entry->key) {
+            entry->key = NULL;  // moved to dst, so src mustn't free it
+        }
+    }
+    return true;
+}
+
+bool ht_merge(ht* dst, ht* src, ht_combine_func combine, void* arg) {
+    return merge(dst, src, combine, arg, false);
+}
+
+bool ht_merge_move(ht* dst, ht* src, ht_combine_func combine, void* arg) {
+    bool ok = merge(dst, src, combine, arg, true);
+    ht_destroy(src);
+    return ok;
+}
+
+void ht_clear(ht* table) {
+    if (table->filter != NULL) {
+        memset(table->filter, 0,
+               FILTER_WORDS(table->capacity) * sizeof(uint64_t));
+    }
+    if (table->slots != NULL) {
+        free_keys(table);
+        memset(table->slots, 0, table->capacity * sizeof(uint32_t));
+        table->length = 0;
+        return;
+    }
+    if (table->compact != NULL) {
+        free_keys(table);
+        memset(table->compact, 0, table->capacity * sizeof(ht_slot));
+        table->length = 0;
+        return;
+    }
+    table->length = 0;
+
+    // With generations, bump the epoch so all slots count as empty. When
+    // the (small) counter wraps, fall through to a full clear so that
+    // slots from 256 generations ago don't come back to life.
+    if (table->epochs != NULL) {
+        table->epoch++;
+        if (table->epoch != 0) {
+            if (table->arena) {
+                free_keys(table);  // stale keys aren't freed one by one
+            }
+            return;
+        }
+        memset(table->epochs, 0, table->capacity * sizeof(uint8_t));
+    }
+
+    // Free allocated keys and zero the entries.
+    free_keys(table);
+    memset(table->entries, 0, table->capacity * sizeof(ht_entry));
+}
+
 hti ht_iterator(ht* table) {
+    return ht_iterator_range(table, 0, ht_span(table));
+}
+
+size_t ht_span(ht* table) {
+    return table->slots != NULL ? table->length : table->capacity;
+}
+
+hti ht_iterator_range(ht* table, size_t begin, size_t end) {
+    // Clamp end so a stale or too-large bound can't read past the
+    // slots (or items) array.
+    size_t span = ht_span(table);
+    if (end > span) {
+        end = span;
+    }
     hti it;
     it._table = table;
-    it._index = 0;
+    it._index = begin;
+    it._end = end;
     return it;
 }
 
+hti ht_iterator_part(ht* table, size_t part, size_t num_parts) {
+    assert(num_parts > 0 && part < num_parts);
+
+    // Compute bounds as span*part/num_parts without overflowing.
+    size_t span = ht_span(table);
+    size_t size = span / num_parts;
+    size_t extra = span % num_parts;
+    size_t begin = part * size + (part < extra ? part : extra);
+    size_t end = begin + size + (part < extra ? 1 : 0);
+    return ht_iterator_range(table, begin, end);
+}
+
 bool ht_next(hti* it) {
-    // Loop till we've hit end of entries array.
+    // Ordered tables just step through the dense items array.
     ht* table = it->_table;
-    while (it->_index < table->capacity) {
+    if (table->slots != NULL) {
+        if (it->_index >= it->_end) {
+            return false;
+        }
+        ht_item item = table->items[it->_index];
+        it->_index++;
+        it->key = item.key;
+        it->value = item.value;
+        return true;
+    }
+
+    // Compact tables find the record each non-empty slot points to.
+    if (table->compact != NULL) {
+        while (it->_index < it->_end) {
+            uint32_t offset = table->compact[it->_index].offset;
+            it->_index++;
+            if (offset != 0) {
+                char* record = compact_record(table, offset);
+                it->key = record + 8;
+                it->value = *(void**)record;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Loop till we've hit end of entries array (or range).
+    while (it->_index < it->_end) {
         size_t i = it->_index;
         it->_index++;
-        if (table->entries[i].key != NULL) {
+        if (!slot_empty(table, i)) {
             // Found next non-empty item, update iterator key and value.
             ht_entry entry = table->entries[i];
             it->key = entry.key;
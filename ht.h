@@ -5,13 +5,70 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 // Hash table structure: create with ht_create, free with ht_destroy.
 typedef struct ht ht;
 
+// Flags for ht_create_flags (combine with |).
+#define HT_EPOCH 0x01    // store slot generations so ht_clear is O(1)
+#define HT_ORDERED 0x02  // keep items dense and in insertion order
+#define HT_ARENA 0x04    // copy keys into shared chunks, not one malloc each
+#define HT_FILTER 0x08   // keep a Bloom filter to speed up failed lookups
+#define HT_COMPACT 0x10  // 8-byte slots, keys and values stored in chunks
+
+// HT_ORDERED tables store items in a dense array, and their hash slots
+// hold only 32-bit indexes into it. Iteration is a sequential scan of
+// exactly ht_length items, in the order they were first inserted. The
+// trade-off is an extra indirection on lookup. HT_EPOCH doesn't apply to
+// ordered tables (ht_clear frees their keys and zeroes the slots).
+
+// HT_ARENA tables copy keys into large append-only chunks instead of
+// allocating each one separately, which packs keys together and makes
+// ht_clear and ht_destroy free them in O(chunks). Keys are still stable
+// till then. This suits tables used with ht_intern.
+
+// HT_FILTER tables keep a small Bloom filter (4 bits per slot, so about
+// 1/32 the size of the slots) that ht_get checks before probing. Most
+// lookups of absent keys then return without touching the slots or
+// comparing any keys, at the cost of a little extra work per insert.
+// Only worth it when a good fraction of lookups miss. ht_clear zeroes
+// the filter, so it's O(capacity) even on an HT_EPOCH table (but with
+// a much smaller constant).
+
+// HT_COMPACT tables have 8-byte hash slots (half the size of normal
+// ones) holding a 32-bit offset to the item and 32 bits of its hash. Each
+// item's value and key are stored together in large chunks, so there's
+// no allocation per key and a hit usually costs one slot read plus one
+// record read. Keys are stable till ht_clear or ht_destroy. Expanding
+// rehashes all keys (reading them in insertion order). Keys and values
+// are limited to 32GB in total. HT_EPOCH, HT_ORDERED and HT_ARENA don't
+// apply to compact tables.
+
+// Tables hash keys with FNV-1a, mixing in a random per-table seed so
+// that which keys collide can't be predicted, and switch to keyed
+// SipHash if an insert still has to probe suspiciously far. As a result
+// iteration order differs between runs.
+//
+// For tests only, set the HT_SEED environment variable to a number (read
+// once, when the first seed is needed) to give every table that seed
+// instead, for repeatable output as in samples/testall.sh. HT_SEED=0 is
+// plain FNV-1a. Don't set it in production: it makes collisions
+// predictable for the whole process.
+
 // Create hash table and return pointer to it, or NULL if out of memory.
 ht* ht_create(void);
 
+// Create hash table with given HT_* flags and return pointer to it, or
+// NULL if out of memory. ht_create() is the same as ht_create_flags(0).
+ht* ht_create_flags(int flags);
+
+// Create empty hash table with the same flags and hash function (seed,
+// or SipHash key if it has switched) as table, and return pointer to
+// it, or NULL if out of memory. Create tables to be merged this way so
+// ht_merge can reuse their saved hashes.
+ht* ht_create_like(ht* table);
+
 // Free memory allocated for hash table, including allocated keys.
 void ht_destroy(ht* table);
 
@@ -25,9 +82,78 @@ void* ht_get(ht* table, const char* key);
 // called). Return address of copied key, or NULL if out of memory.
 const char* ht_set(ht* table, const char* key, void* value);
 
+// Intern string str (len bytes, which must not contain NUL) and return
+// the table's canonical NUL-terminated copy of it: the same pointer for
+// every call with equal strings, so interned strings can be compared by
+// pointer. If str is new, it's copied and added with the copy itself as
+// its value (so ht_get returns the canonical pointer too). Needs only a
+// single probe. Return NULL if out of memory.
+const char* ht_intern(ht* table, const char* str, size_t len);
+
 // Return number of items in hash table.
 size_t ht_length(ht* table);
 
+// Return number of bytes of memory used by hash table, including its
+// slots and keys (but not values, or malloc's own overhead).
+size_t ht_memory(ht* table);
+
+// Grow hash table (if needed) so that num_items items fit without it
+// having to expand. Return true on success, false if out of memory.
+bool ht_reserve(ht* table, size_t num_items);
+
+// Return new hash table with the same flags, seed and items as table
+// (keys are copied, values are not), or NULL if out of memory.
+ht* ht_copy(ht* table);
+
+// Function called by ht_merge for each key in both tables, with dst's
+// and src's values for it. Return value to store in dst (which must not
+// be NULL). arg is passed through from ht_merge.
+typedef void* (*ht_combine_func)(const char* key, void* dst_value,
+                                 void* src_value, void* arg);
+
+// Merge all items of src into dst. Keys new to dst are copied and set
+// to src's value. Keys in both tables are set to the value combine
+// returns (or to src's value if combine is NULL, like ht_set). dst is
+// grown up front to fit at least as many items as the larger table
+// (merging into an empty table never rehashes partway). An HT_ORDERED
+// src's saved hashes are reused only if both tables use the same hash
+// function, which separately created tables don't (each has its own
+// random seed): create one from the other with ht_create_like or
+// ht_copy. src isn't modified. Return true on success, false if out of
+// memory (dst may then hold some of src's items).
+bool ht_merge(ht* dst, ht* src, ht_combine_func combine, void* arg);
+
+// Same as ht_merge, but destroy src afterwards (even on failure). Keys
+// new to dst are moved rather than copied, unless either table is
+// HT_ARENA or HT_COMPACT. Values are never freed (combine can free
+// src's values if needed).
+bool ht_merge_move(ht* dst, ht* src, ht_combine_func combine, void* arg);
+
+// Remove all items from hash table, keeping its current capacity. Keys
+// are freed, values are not (free them first if needed). Normally this
+// is O(capacity), but on an HT_EPOCH table it just bumps the table's
+// generation number, and keys of old items are freed lazily as their
+// slots are reused (or when ht_destroy is called).
+void ht_clear(ht* table);
+
+// Return a new random seed for ht_hash (the value of HT_SEED if that's
+// set to a valid number), as ht_create does for each table.
+uint64_t ht_seed(void);
+
+// Return 64-bit FNV-1a hash of key (NUL-terminated) with seed mixed in,
+// as a table with that seed hashes it. For code built on ht that needs
+// to route or hash keys itself.
+uint64_t ht_hash(uint64_t seed, const char* key);
+
+// Fill key with 128 random bits for ht_siphash, from /dev/urandom if
+// possible, falling back to mixing the clock and an address. Unlike
+// ht_seed, this ignores HT_SEED, so a SipHash key is always secret.
+void ht_random_key(uint64_t key[2]);
+
+// Return 64-bit SipHash-1-3 of key (len bytes) with 128-bit secret k.
+// Slower than ht_hash, but safe even if attackers can see hash effects.
+uint64_t ht_siphash(const uint64_t k[2], const char* key, size_t len);
+
 // Hash table iterator: create with ht_iterator, iterate with ht_next.
 typedef struct {
     const char* key;  // current key
@@ -35,15 +161,37 @@ typedef struct {
 
     // Don't use these fields directly.
     ht* _table;       // reference to hash table being iterated
-    size_t _index;    // current index into ht._entries
+    size_t _index;    // current index into ht._entries (or items)
+    size_t _end;      // index to stop iterating at
 } hti;
 
 // Return new hash table iterator (for use with ht_next).
 hti ht_iterator(ht* table);
 
+// Return number of positions ht_iterator walks over: the table's
+// capacity, or its length for HT_ORDERED tables. Use this as the upper
+// bound for ht_iterator_range.
+size_t ht_span(ht* table);
+
+// Return iterator over positions begin up to (but not including) end,
+// where end is clamped to ht_span(table). Iterators over disjoint ranges
+// visit disjoint items, and as ht_next doesn't modify the table, they
+// may be used concurrently from different threads (as long as nothing
+// is calling ht_set).
+hti ht_iterator_range(ht* table, size_t begin, size_t end);
+
+// Return iterator over part number part (0 to num_parts-1, and
+// num_parts must not be zero) of the table, splitting its span into
+// num_parts near-equal ranges. Items are split exactly evenly for
+// HT_ORDERED tables, and evenly on average otherwise (as hashes spread
+// items uniformly over the slots).
+hti ht_iterator_part(ht* table, size_t part, size_t num_parts);
+
 // Move iterator to next item in hash table, update iterator's key
 // and value to current item, and return true. If there are no more
-// items, return false. Don't call ht_set during iteration.
+// items, return false. Don't call ht_set during iteration. Items are
+// returned in insertion order for HT_ORDERED tables, otherwise in an
+// order that depends on the keys' hashes.
 bool ht_next(hti* it);
 
 #endif // _HT_H
@@ -0,0 +1,207 @@
+// Simple hash table with 64-bit integer keys, implemented in C.
+
+#include "ht64.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// Hash table entry (slot may be filled or empty). Key 0 is the empty
+// sentinel, so an item with key 0 is kept in ht64.zero_value instead.
+typedef struct {
+    uint64_t key;  // key is 0 if this slot is empty
+    void* value;
+} ht64_entry;
+
+// Hash table structure: create with ht64_create, free with ht64_destroy.
+struct ht64 {
+    ht64_entry* entries;  // hash slots
+    size_t capacity;      // size of _entries array
+    size_t length;        // number of items in hash table
+    void* zero_value;     // value for key 0, or NULL if not present
+};
+
+#define INITIAL_CAPACITY 16  // must not be zero
+
+ht64* ht64_create(void) {
+    // Allocate space for hash table struct.
+    ht64* table = malloc(sizeof(ht64));
+    if (table == NULL) {
+        return NULL;
+    }
+    table->length = 0;
+    table->capacity = INITIAL_CAPACITY;
+    table->zero_value = NULL;
+
+    // Allocate (zero'd) space for entry buckets.
+    table->entries = calloc(table->capacity, sizeof(ht64_entry));
+    if (table->entries == NULL) {
+        free(table);
+        return NULL;
+    }
+    return table;
+}
+
+void ht64_destroy(ht64* table) {
+    free(table->entries);
+    free(table);
+}
+
+// Return 64-bit hash for key, mixing all its bits into the low ones
+// (integer IDs are often sequential or share low bits, so the identity
+// hash would cluster badly with linear probing). This is the finalizer
+// from MurmurHash3: https://github.com/aappleby/smhasher
+static inline uint64_t hash_key(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+void* ht64_get(ht64* table, uint64_t key) {
+    if (key == 0) {
+        return table->zero_value;
+    }
+
+    // AND hash with capacity-1 to ensure it's within entries array.
+    size_t index = (size_t)(hash_key(key) & (uint64_t)(table->capacity - 1));
+
+    // Loop till we find an empty entry.
+    while (table->entries[index].key != 0) {
+        if (table->entries[index].key == key) {
+            // Found key, return value.
+            return table->entries[index].value;
+        }
+        // Key wasn't in this slot, move to next (linear probing).
+        index++;
+        if (index >= table->capacity) {
+            // At end of entries array, wrap around.
+            index = 0;
+        }
+    }
+    return NULL;
+}
+
+// Internal function to set an entry (without expanding table). Return
+// true if a new item was added, false if an existing one was updated.
+static bool ht64_set_entry(ht64_entry* entries, size_t capacity,
+        uint64_t key, void* value) {
+    // AND hash with capacity-1 to ensure it's within entries array.
+    size_t index = (size_t)(hash_key(key) & (uint64_t)(capacity - 1));
+
+    // Loop till we find an empty entry.
+    while (entries[index].key != 0) {
+        if (entries[index].key == key) {
+            // Found key (it already exists), update value.
+            entries[index].value = value;
+            return false;
+        }
+        // Key wasn't in this slot, move to next (linear probing).
+        index++;
+        if (index >= capacity) {
+            // At end of entries array, wrap around.
+            index = 0;
+        }
+    }
+
+    // Didn't find key, insert it (no copy needed).
+    entries[index].key = key;
+    entries[index].value = value;
+    return true;
+}
+
+// Expand hash table to twice its current size. Return true on success,
+// false if out of memory.
+static bool ht64_expand(ht64* table) {
+    // Allocate new entries array.
+    size_t new_capacity = table->capacity * 2;
+    if (new_capacity < table->capacity) {
+        return false;  // overflow (capacity would be too big)
+    }
+    ht64_entry* new_entries = calloc(new_capacity, sizeof(ht64_entry));
+    if (new_entries == NULL) {
+        return false;
+    }
+
+    // Iterate entries, move all non-empty ones to new table's entries.
+    for (size_t i = 0; i < table->capacity; i++) {
+        ht64_entry entry = table->entries[i];
+        if (entry.key != 0) {
+            ht64_set_entry(new_entries, new_capacity, entry.key, entry.value);
+        }
+    }
+
+    // Free old entries array and update this table's details.
+    free(table->entries);
+    table->entries = new_entries;
+    table->capacity = new_capacity;
+    return true;
+}
+
+bool ht64_set(ht64* table, uint64_t key, void* value) {
+    assert(value != NULL);
+    if (value == NULL) {
+        return false;
+    }
+
+    // Key 0 is the empty sentinel, so it's stored outside the entries.
+    if (key == 0) {
+        if (table->zero_value == NULL) {
+            table->length++;
+        }
+        table->zero_value = value;
+        return true;
+    }
+
+    // If length will exceed half of current capacity, expand it.
+    if (table->length >= table->capacity / 2) {
+        if (!ht64_expand(table)) {
+            return false;
+        }
+    }
+
+    // Set entry and update length.
+    if (ht64_set_entry(table->entries, table->capacity, key, value)) {
+        table->length++;
+    }
+    return true;
+}
+
+size_t ht64_length(ht64* table) {
+    return table->length;
+}
+
+ht64i ht64_iterator(ht64* table) {
+    ht64i it;
+    it._table = table;
+    it._index = 0;
+    return it;
+}
+
+bool ht64_next(ht64i* it) {
+    // Loop till we've hit end of entries array.
+    ht64* table = it->_table;
+    while (it->_index < table->capacity) {
+        size_t i = it->_index;
+        it->_index++;
+        if (table->entries[i].key != 0) {
+            // Found next non-empty item, update iterator key and value.
+            ht64_entry entry = table->entries[i];
+            it->key = entry.key;
+            it->value = entry.value;
+            return true;
+        }
+    }
+
+    // Finally, the zero key (if present).
+    if (it->_index == table->capacity) {
+        it->_index++;
+        if (table->zero_value != NULL) {
+            it->key = 0;
+            it->value = table->zero_value;
+            return true;
+        }
+    }
+    return false;
+}
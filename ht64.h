@@ -0,0 +1,49 @@
+// Simple hash table with 64-bit integer keys, implemented in C.
+
+#ifndef _HT64_H
+#define _HT64_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hash table structure: create with ht64_create, free with ht64_destroy.
+typedef struct ht64 ht64;
+
+// Create hash table and return pointer to it, or NULL if out of memory.
+ht64* ht64_create(void);
+
+// Free memory allocated for hash table (keys are stored inline).
+void ht64_destroy(ht64* table);
+
+// Get item with given key from hash table. Return value (which was set
+// with ht64_set), or NULL if key not found.
+void* ht64_get(ht64* table, uint64_t key);
+
+// Set item with given key (any value, including 0) to value (which
+// must not be NULL). Return true on success, false if out of memory.
+bool ht64_set(ht64* table, uint64_t key, void* value);
+
+// Return number of items in hash table.
+size_t ht64_length(ht64* table);
+
+// Hash table iterator: create with ht64_iterator, iterate with ht64_next.
+typedef struct {
+    uint64_t key;     // current key
+    void* value;      // current value
+
+    // Don't use these fields directly.
+    ht64* _table;     // reference to hash table being iterated
+    size_t _index;    // current index into ht64._entries (capacity means
+                      // the zero key, which is stored separately)
+} ht64i;
+
+// Return new hash table iterator (for use with ht64_next).
+ht64i ht64_iterator(ht64* table);
+
+// Move iterator to next item in hash table, update iterator's key
+// and value to current item, and return true. If there are no more
+// items, return false. Don't call ht64_set during iteration.
+bool ht64_next(ht64i* it);
+
+#endif // _HT64_H
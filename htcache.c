@@ -0,0 +1,272 @@
+// Fixed-capacity cache of string keys with CLOCK eviction, implemented
+// in C using the same hashing and linear probing as ht.
+
+#include "htcache.h"
+#include "ht.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cache entry (slot may be filled or empty).
+typedef struct {
+    const char* key;  // key is NULL if this slot is empty
+    void* value;
+    uint64_t hash;    // saved so deletion can find an item's home slot
+} htcache_entry;
+
+// Cache structure: create with htcache_create, free with htcache_destroy.
+// Recency is one "referenced" bit per slot, which the clock hand clears
+// as it sweeps the slots looking for an unreferenced item to evict.
+struct htcache {
+    htcache_entry* entries;  // hash slots
+    uint8_t* refs;           // per-slot referenced bits
+    size_t capacity;         // size of _entries array
+    size_t length;           // number of items in cache
+    size_t max_items;        // evict when length would exceed this
+    size_t hand;             // clock hand: next slot to consider evicting
+    htcache_evict_func evict;
+    void* arg;               // passed to evict
+    uint64_t seed;           // random per-cache seed for FNV-1a
+    bool keyed;              // true if hashing with SipHash (under attack)
+    uint64_t sip_key[2];     // random per-cache key for SipHash
+};
+
+htcache* htcache_create(size_t max_items, htcache_evict_func evict,
+                        void* arg) {
+    assert(max_items > 0);
+
+    // Keep cache at most half full, like ht does.
+    size_t capacity = 16;
+    while (capacity / 2 < max_items) {
+        capacity *= 2;
+        if (capacity == 0) {
+            return NULL;  // overflow (capacity would be too big)
+        }
+    }
+
+    // Allocate space for cache struct and (zero'd) slots.
+    htcache* cache = malloc(sizeof(htcache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->entries = calloc(capacity, sizeof(htcache_entry));
+    cache->refs = calloc(capacity, sizeof(uint8_t));
+    if (cache->entries == NULL || cache->refs == NULL) {
+        free(cache->entries);
+        free(cache->refs);
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+    cache->length = 0;
+    cache->max_items = max_items;
+    cache->hand = 0;
+    cache->evict = evict;
+    cache->arg = arg;
+    cache->seed = ht_seed();
+    cache->keyed = false;
+    return cache;
+}
+
+void htcache_destroy(htcache* cache) {
+    // First pass remaining items to evict and free allocated keys.
+    for (size_t i = 0; i < cache->capacity; i++) {
+        htcache_entry* entry = &cache->entries[i];
+        if (entry->key == NULL) {
+            continue;
+        }
+        if (cache->evict != NULL) {
+            cache->evict(entry->key, entry->value, cache->arg);
+        }
+        free((void*)entry->key);
+    }
+
+    // Then free slots and cache itself.
+    free(cache->entries);
+    free(cache->refs);
+    free(cache);
+}
+
+// Return 64-bit hash for key (NUL-terminated): seeded FNV-1a, or keyed
+// SipHash after a suspiciously long probe, as in ht.
+static uint64_t hash_key(htcache* cache, const char* key) {
+    if (cache->keyed) {
+        return ht_siphash(cache->sip_key, key, strlen(key));
+    }
+    return ht_hash(cache->seed, key);
+}
+
+// Same limit as ht's: inserting further than this from the home slot
+// means keys were likely chosen to collide.
+#define MAX_PROBE_LEN 128
+
+// Return index of slot holding key, or of the empty slot where it
+// should go if it's not in the cache.
+static size_t find_slot(htcache* cache, const char* key, uint64_t hash) {
+    // AND hash with capacity-1 to ensure it's within entries array.
+    size_t mask = cache->capacity - 1;
+    size_t index = (size_t)(hash & (uint64_t)mask);
+
+    // Loop till we find key or an empty entry.
+    while (cache->entries[index].key != NULL) {
+        htcache_entry* entry = &cache->entries[index];
+        if (entry->hash == hash && strcmp(key, entry->key) == 0) {
+            break;
+        }
+        // Key wasn't in this slot, move to next (linear probing).
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+void* htcache_get(htcache* cache, const char* key) {
+    size_t index = find_slot(cache, key, hash_key(cache, key));
+    if (cache->entries[index].key == NULL) {
+        return NULL;
+    }
+    cache->refs[index] = 1;
+    return cache->entries[index].value;
+}
+
+// Remove item in slot at index, shifting later items in its probe run
+// back so lookups don't stop early at the hole (no tombstones needed).
+static void delete_slot(htcache* cache, size_t index) {
+    size_t mask = cache->capacity - 1;
+    size_t hole = index;
+    size_t i = index;
+    for (;;) {
+        cache->entries[hole].key = NULL;
+        cache->refs[hole] = 0;
+
+        // Find next item in run that may move back into the hole: one
+        // whose home slot isn't between the hole and its current slot.
+        for (;;) {
+            i = (i + 1) & mask;
+            htcache_entry* entry = &cache->entries[i];
+            if (entry->key == NULL) {
+                return;  // end of run
+            }
+            size_t home = (size_t)(entry->hash & (uint64_t)mask);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                break;
+            }
+        }
+        cache->entries[hole] = cache->entries[i];
+        cache->refs[hole] = cache->refs[i];
+        hole = i;
+    }
+}
+
+// Evict one item, chosen by sweeping the clock hand round the slots:
+// referenced items get their bit cleared (a second chance), and the
+// first unreferenced item found is evicted.
+static void evict_one(htcache* cache) {
+    size_t mask = cache->capacity - 1;
+    for (;;) {
+        size_t i = cache->hand;
+        cache->hand = (i + 1) & mask;
+        if (cache->entries[i].key == NULL) {
+            continue;
+        }
+        if (cache->refs[i]) {
+            cache->refs[i] = 0;
+            continue;
+        }
+
+        htcache_entry entry = cache->entries[i];
+        delete_slot(cache, i);
+        cache->length--;
+        cache->hand = i;  // slot may now hold a shifted-back item
+        if (cache->evict != NULL) {
+            cache->evict(entry.key, entry.value, cache->arg);
+        }
+        free((void*)entry.key);
+        return;
+    }
+}
+
+// Switch cache to SipHash with a new random key and move all items to
+// their new slots (with their referenced bits). If out of memory, keep
+// the old hashing, which is slow under attack but still correct.
+static void rekey(htcache* cache) {
+    htcache_entry* old_entries = cache->entries;
+    uint8_t* old_refs = cache->refs;
+    cache->entries = calloc(cache->capacity, sizeof(htcache_entry));
+    cache->refs = calloc(cache->capacity, sizeof(uint8_t));
+    if (cache->entries == NULL || cache->refs == NULL) {
+        free(cache->entries);
+        free(cache->refs);
+        cache->entries = old_entries;
+        cache->refs = old_refs;
+        return;
+    }
+
+    cache->keyed = true;
+    ht_random_key(cache->sip_key);
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (old_entries[i].key == NULL) {
+            continue;
+        }
+        uint64_t hash = hash_key(cache, old_entries[i].key);
+        size_t index = find_slot(cache, old_entries[i].key, hash);
+        cache->entries[index] = old_entries[i];
+        cache->entries[index].hash = hash;
+        cache->refs[index] = old_refs[i];
+    }
+    free(old_entries);
+    free(old_refs);
+}
+
+const char* htcache_put(htcache* cache, const char* key, void* value) {
+    assert(value != NULL);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    uint64_t hash = hash_key(cache, key);
+    size_t index = find_slot(cache, key, hash);
+    htcache_entry* entry = &cache->entries[index];
+    if (entry->key != NULL) {
+        // Found key (it already exists), replace value.
+        void* old_value = entry->value;
+        entry->value = value;
+        cache->refs[index] = 1;
+        if (cache->evict != NULL && old_value != value) {
+            cache->evict(entry->key, old_value, cache->arg);
+        }
+        return entry->key;
+    }
+
+    // Didn't find key, make space if needed (which may move items, so
+    // find the empty slot again), then copy and insert it.
+    if (cache->length >= cache->max_items) {
+        evict_one(cache);
+        index = find_slot(cache, key, hash);
+        entry = &cache->entries[index];
+    }
+    key = strdup(key);
+    if (key == NULL) {
+        return NULL;
+    }
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash;
+    // New items start unreferenced, so items that are never used again
+    // go on the hand's next pass. On skewed workloads this beats classic
+    // CLOCK, which sets the bit on insert (about 3% better hit rate in
+    // samples/perfcache.c).
+    cache->refs[index] = 0;
+    cache->length++;
+
+    size_t distance = (index - (size_t)hash) & (cache->capacity - 1);
+    if (!cache->keyed && distance > MAX_PROBE_LEN) {
+        rekey(cache);
+    }
+    return key;
+}
+
+size_t htcache_length(htcache* cache) {
+    return cache->length;
+}
@@ -0,0 +1,43 @@
+// Fixed-capacity cache of string keys with CLOCK eviction, implemented
+// in C using the same hashing and linear probing as ht (so link with
+// ht.c too).
+
+#ifndef _HTCACHE_H
+#define _HTCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cache structure: create with htcache_create, free with htcache_destroy.
+typedef struct htcache htcache;
+
+// Function called with key and value of each item evicted from cache,
+// plus the arg passed to htcache_create. The key is freed after this
+// returns; the value belongs to the callback (for example, free it).
+typedef void (*htcache_evict_func)(const char* key, void* value, void* arg);
+
+// Create cache holding at most max_items items (which must not be zero)
+// and return pointer to it, or NULL if out of memory. All memory is
+// allocated up front. If evict isn't NULL, it's called for each item
+// evicted to make space, each value replaced by htcache_put, and each
+// item still in the cache when htcache_destroy is called.
+htcache* htcache_create(size_t max_items, htcache_evict_func evict,
+                        void* arg);
+
+// Free memory allocated for cache, including allocated keys.
+void htcache_destroy(htcache* cache);
+
+// Get item with given key (NUL-terminated) from cache and mark it as
+// recently used. Return value, or NULL if key not found.
+void* htcache_get(htcache* cache, const char* key);
+
+// Set item with given key (NUL-terminated) to value (which must not be
+// NULL). If key isn't already present and the cache is full, first
+// evict an item that hasn't been used recently. Return address of
+// copied key, or NULL if out of memory.
+const char* htcache_put(htcache* cache, const char* key, void* value);
+
+// Return number of items in cache.
+size_t htcache_length(htcache* cache);
+
+#endif // _HTCACHE_H
@@ -0,0 +1,181 @@
+// Read-mostly hash table with read-copy-update (RCU) snapshots,
+// implemented in C on top of ht.
+
+#include "htrcu.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Reader registration. Padded to a cache line so readers don't slow
+// each other down by writing to the same line.
+struct htrcu_reader {
+    _Atomic uint64_t epoch;  // table epoch seen at last quiescent state
+    htrcu* table;
+    htrcu_reader* next;      // next registered reader
+    char _pad[64 - sizeof(uint64_t) - 2 * sizeof(void*)];
+};
+
+// Old version of table, waiting for readers to move on before freeing.
+typedef struct retired {
+    ht* version;
+    uint64_t epoch;          // epoch at which it was replaced
+    struct retired* next;
+} retired;
+
+// RCU table structure: create with htrcu_create, free with htrcu_destroy.
+struct htrcu {
+    _Atomic(ht*) current;    // version readers should use
+    _Atomic uint64_t epoch;  // incremented each time a version is retired
+    pthread_mutex_t lock;    // held by writers and (un)registering readers
+    htrcu_reader* readers;   // registered readers
+    retired* retired;        // old versions not freed yet
+};
+
+htrcu* htrcu_create(ht* initial) {
+    htrcu* table = malloc(sizeof(htrcu));
+    if (table == NULL) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&table->lock, NULL) != 0) {
+        free(table);
+        return NULL;
+    }
+    atomic_init(&table->current, initial);
+    atomic_init(&table->epoch, 0);
+    table->readers = NULL;
+    table->retired = NULL;
+    return table;
+}
+
+void htrcu_destroy(htrcu* table) {
+    while (table->retired != NULL) {
+        retired* r = table->retired;
+        table->retired = r->next;
+        ht_destroy(r->version);
+        free(r);
+    }
+    ht_destroy(atomic_load(&table->current));
+    pthread_mutex_destroy(&table->lock);
+    free(table);
+}
+
+htrcu_reader* htrcu_register(htrcu* table) {
+    htrcu_reader* reader = aligned_alloc(64, sizeof(htrcu_reader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    reader->table = table;
+    pthread_mutex_lock(&table->lock);
+    atomic_init(&reader->epoch, atomic_load(&table->epoch));
+    reader->next = table->readers;
+    table->readers = reader;
+    pthread_mutex_unlock(&table->lock);
+    return reader;
+}
+
+void htrcu_unregister(htrcu_reader* reader) {
+    htrcu* table = reader->table;
+    pthread_mutex_lock(&table->lock);
+    htrcu_reader** p = &table->readers;
+    while (*p != reader) {
+        p = &(*p)->next;
+    }
+    *p = reader->next;
+    pthread_mutex_unlock(&table->lock);
+    free(reader);
+}
+
+void* htrcu_get(htrcu* table, const char* key) {
+    // Acquire pairs with the writer's release, so the new version's
+    // contents are visible before we use it.
+    ht* version = atomic_load_explicit(&table->current, memory_order_acquire);
+    return ht_get(version, key);
+}
+
+void htrcu_quiescent(htrcu_reader* reader) {
+    uint64_t epoch = atomic_load_explicit(&reader->table->epoch,
+                                          memory_order_acquire);
+    atomic_store_explicit(&reader->epoch, epoch, memory_order_release);
+}
+
+// Return the oldest epoch any registered reader may still be reading
+// in (caller must hold the lock).
+static uint64_t min_reader_epoch(htrcu* table) {
+    uint64_t min = atomic_load(&table->epoch);
+    for (htrcu_reader* r = table->readers; r != NULL; r = r->next) {
+        uint64_t epoch = atomic_load_explicit(&r->epoch, memory_order_acquire);
+        if (epoch < min) {
+            min = epoch;
+        }
+    }
+    return min;
+}
+
+// Free retired versions that no reader can still be using (caller must
+// hold the lock). A version retired at epoch e is safe once every reader
+// has been quiescent after seeing epoch e.
+static void reclaim(htrcu* table) {
+    uint64_t min = min_reader_epoch(table);
+    retired** p = &table->retired;
+    while (*p != NULL) {
+        retired* r = *p;
+        if (r->epoch <= min) {
+            *p = r->next;
+            ht_destroy(r->version);
+            free(r);
+        } else {
+            p = &r->next;
+        }
+    }
+}
+
+bool htrcu_set(htrcu* table, const char* key, void* value) {
+    pthread_mutex_lock(&table->lock);
+
+    // Copy current version and update the copy.
+    ht* old = atomic_load(&table->current);
+    ht* version = ht_copy(old);
+    retired* r = malloc(sizeof(retired));
+    if (version == NULL || r == NULL || ht_set(version, key, value) == NULL) {
+        if (version != NULL) {
+            ht_destroy(version);
+        }
+        free(r);
+        pthread_mutex_unlock(&table->lock);
+        return false;
+    }
+
+    // Publish it, then retire the old version at the next epoch: readers
+    // that see that epoch in htrcu_quiescent will only load the new one.
+    atomic_store_explicit(&table->current, version, memory_order_release);
+    r->version = old;
+    r->epoch = atomic_fetch_add(&table->epoch, 1) + 1;
+    r->next = table->retired;
+    table->retired = r;
+
+    reclaim(table);
+    pthread_mutex_unlock(&table->lock);
+    return true;
+}
+
+void htrcu_synchronize(htrcu* table) {
+    pthread_mutex_lock(&table->lock);
+    uint64_t target = atomic_load(&table->epoch);
+    while (min_reader_epoch(table) < target) {
+        // Let readers run (they may need this CPU to reach a quiescent
+        // state). The lock only keeps readers from (un)registering.
+        pthread_mutex_unlock(&table->lock);
+        sched_yield();
+        pthread_mutex_lock(&table->lock);
+    }
+    reclaim(table);
+    pthread_mutex_unlock(&table->lock);
+}
+
+size_t htrcu_length(htrcu* table) {
+    return ht_length(atomic_load_explicit(&table->current,
+                                          memory_order_acquire));
+}
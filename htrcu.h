@@ -0,0 +1,67 @@
+// Read-mostly hash table with read-copy-update (RCU) snapshots,
+// implemented in C on top of ht.
+
+#ifndef _HTRCU_H
+#define _HTRCU_H
+
+#include "ht.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// RCU table structure: create with htrcu_create, free with htrcu_destroy.
+// Readers look up keys in the current version of the table without
+// locking: a get is one atomic (acquire) load of the version pointer
+// plus an ordinary ht_get. Writers copy the current version, change the
+// copy, and publish it with one atomic pointer store, so writes are
+// O(n) and meant to be rare. Old versions are freed once every
+// registered reader has passed a quiescent state (called
+// htrcu_quiescent) after the new version was published.
+typedef struct htrcu htrcu;
+
+// Reader registration: each reader thread gets its own.
+typedef struct htrcu_reader htrcu_reader;
+
+// Create RCU table whose first version is initial (which the RCU table
+// takes ownership of, so build it with the usual ht functions first).
+// Return pointer to RCU table, or NULL if out of memory.
+htrcu* htrcu_create(ht* initial);
+
+// Free memory allocated for RCU table and all its versions. No readers
+// may be registered.
+void htrcu_destroy(htrcu* table);
+
+// Register calling thread as a reader and return its registration, or
+// NULL if out of memory.
+htrcu_reader* htrcu_register(htrcu* table);
+
+// Unregister reader (after which it mustn't call htrcu_get).
+void htrcu_unregister(htrcu_reader* reader);
+
+// Get item with given key (NUL-terminated) from current version of RCU
+// table. Return value, or NULL if key not found. Never blocks.
+void* htrcu_get(htrcu* table, const char* key);
+
+// Tell writers that reader is holding no pointers from earlier gets
+// (except to values it knows are still live), so versions it may have
+// been reading can be freed. Call this regularly, for example between
+// requests. It's a single store that never blocks.
+void htrcu_quiescent(htrcu_reader* reader);
+
+// Set item with given key (NUL-terminated) to value (which must not be
+// NULL) and publish the new version. Writers are serialized with a
+// mutex. Return true on success, false if out of memory. A value this
+// replaces may still be in use by readers till htrcu_synchronize
+// returns.
+bool htrcu_set(htrcu* table, const char* key, void* value);
+
+// Wait till every registered reader has passed a quiescent state since
+// the latest version was published, and free all old versions. Call
+// from a writer (not from a registered reader, which would wait for
+// itself), for example before freeing replaced values.
+void htrcu_synchronize(htrcu* table);
+
+// Return number of items in current version of RCU table.
+size_t htrcu_length(htrcu* table);
+
+#endif // _HTRCU_H
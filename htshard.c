@@ -0,0 +1,187 @@
+// Sharded hash table: a front end that splits keys across 2^k
+// independent ht tables, implemented in C.
+
+#include "htshard.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Sharded table structure: create with hts_create, free with hts_destroy.
+struct hts {
+    ht** shards;        // 2^shard_bits independent tables
+    int shard_bits;     // number of high hash bits used to pick shard
+    uint64_t seed;      // random seed for routing hash (see ht_hash)
+};
+
+hts* hts_create(int shard_bits, int flags) {
+    if (shard_bits < 0 || shard_bits > HTS_MAX_SHARD_BITS) {
+        return NULL;
+    }
+
+    // Allocate space for table struct and shard pointers.
+    hts* table = malloc(sizeof(hts));
+    if (table == NULL) {
+        return NULL;
+    }
+    size_t num_shards = (size_t)1 << shard_bits;
+    table->shard_bits = shard_bits;
+    table->seed = ht_seed();
+    table->shards = calloc(num_shards, sizeof(ht*));
+    if (table->shards == NULL) {
+        free(table);
+        return NULL;
+    }
+
+    // Create shards, freeing the ones created so far on error.
+    for (size_t i = 0; i < num_shards; i++) {
+        table->shards[i] = ht_create_flags(flags);
+        if (table->shards[i] == NULL) {
+            hts_destroy(table);
+            return NULL;
+        }
+    }
+    return table;
+}
+
+void hts_destroy(hts* table) {
+    for (size_t i = 0; i < hts_num_shards(table); i++) {
+        if (table->shards[i] != NULL) {
+            ht_destroy(table->shards[i]);
+        }
+    }
+    free(table->shards);
+    free(table);
+}
+
+// Return shard for key. Uses the high bits of the hash, as each shard
+// uses the low bits to pick a slot. The hash is seeded like a table's,
+// so keys can't be aimed at one shard without knowing the seed.
+static ht* key_shard(hts* table, const char* key) {
+    if (table->shard_bits == 0) {
+        return table->shards[0];
+    }
+    uint64_t hash = ht_hash(table->seed, key);
+    return table->shards[hash >> (64 - table->shard_bits)];
+}
+
+void* hts_get(hts* table, const char* key) {
+    return ht_get(key_shard(table, key), key);
+}
+
+const char* hts_set(hts* table, const char* key, void* value) {
+    return ht_set(key_shard(table, key), key, value);
+}
+
+size_t hts_length(hts* table) {
+    size_t length = 0;
+    for (size_t i = 0; i < hts_num_shards(table); i++) {
+        length += ht_length(table->shards[i]);
+    }
+    return length;
+}
+
+size_t hts_num_shards(hts* table) {
+    return (size_t)1 << table->shard_bits;
+}
+
+ht* hts_shard(hts* table, size_t i) {
+    return table->shards[i];
+}
+
+// Work for one hts_reserve thread: reserve shards first, first+step, ...
+typedef struct {
+    hts* table;
+    size_t first;
+    size_t step;
+    size_t per_shard;
+    bool ok;
+} reserve_job;
+
+static void* reserve_shards(void* arg) {
+    reserve_job* job = (reserve_job*)arg;
+    job->ok = true;
+    for (size_t i = job->first; i < hts_num_shards(job->table); i += job->step) {
+        if (!ht_reserve(job->table->shards[i], job->per_shard)) {
+            job->ok = false;
+        }
+    }
+    return NULL;
+}
+
+bool hts_reserve(hts* table, size_t num_items, int num_threads) {
+    size_t num_shards = hts_num_shards(table);
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if ((size_t)num_threads > num_shards) {
+        num_threads = (int)num_shards;
+    }
+
+    // Allow some slack over an even split, as shards won't get exactly
+    // the same number of items.
+    size_t per_shard = num_items / num_shards;
+    per_shard += per_shard / 16 + 1;
+
+    reserve_job* jobs = malloc(num_threads * sizeof(reserve_job));
+    pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+    if (jobs == NULL || threads == NULL) {
+        free(jobs);
+        free(threads);
+        return false;
+    }
+
+    // Run jobs on new threads, or on this thread if that fails.
+    for (int t = 0; t < num_threads; t++) {
+        jobs[t].table = table;
+        jobs[t].first = (size_t)t;
+        jobs[t].step = (size_t)num_threads;
+        jobs[t].per_shard = per_shard;
+    }
+    int started = 0;
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&threads[t], NULL, reserve_shards, &jobs[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+    for (int t = started + 1; t < num_threads; t++) {
+        reserve_shards(&jobs[t]);
+    }
+    reserve_shards(&jobs[0]);
+
+    bool ok = jobs[0].ok;
+    for (int t = 1; t < num_threads; t++) {
+        if (t <= started) {
+            pthread_join(threads[t], NULL);
+        }
+        ok = ok && jobs[t].ok;
+    }
+    free(jobs);
+    free(threads);
+    return ok;
+}
+
+htsi hts_iterator(hts* table) {
+    htsi it;
+    it._table = table;
+    it._shard = 0;
+    it._it = ht_iterator(table->shards[0]);
+    return it;
+}
+
+bool hts_next(htsi* it) {
+    // Iterate current shard, moving on to the next when it's done.
+    for (;;) {
+        if (ht_next(&it->_it)) {
+            it->key = it->_it.key;
+            it->value = it->_it.value;
+            return true;
+        }
+        it->_shard++;
+        if (it->_shard >= hts_num_shards(it->_table)) {
+            return false;
+        }
+        it->_it = ht_iterator(it->_table->shards[it->_shard]);
+    }
+}
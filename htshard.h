@@ -0,0 +1,72 @@
+// Sharded hash table: a front end that splits keys across 2^k
+// independent ht tables, implemented in C.
+
+#ifndef _HTSHARD_H
+#define _HTSHARD_H
+
+#include "ht.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Sharded table structure: create with hts_create, free with hts_destroy.
+// Each key is routed to a shard by the high bits of its hash (seeded
+// randomly per sharded table, like an ht's; see HT_SEED), and each
+// shard is an ordinary ht that expands on its own. So no single
+// allocation is bigger than one shard, an expand only rehashes one shard
+// (briefly needing 3x that shard's slots, not 3x the whole table's),
+// and shards can be grown in parallel.
+typedef struct hts hts;
+
+#define HTS_MAX_SHARD_BITS 16
+
+// Create sharded table with 2^shard_bits shards (0 to
+// HTS_MAX_SHARD_BITS), each created with ht_create_flags(flags). Return
+// pointer to it, or NULL if out of memory.
+hts* hts_create(int shard_bits, int flags);
+
+// Free memory allocated for sharded table, including allocated keys.
+void hts_destroy(hts* table);
+
+// Get item with given key (NUL-terminated) from sharded table. Return
+// value (which was set with hts_set), or NULL if key not found.
+void* hts_get(hts* table, const char* key);
+
+// Set item with given key (NUL-terminated) to value (which must not be
+// NULL), as per ht_set. Return address of copied key, or NULL if out
+// of memory.
+const char* hts_set(hts* table, const char* key, void* value);
+
+// Return number of items in sharded table.
+size_t hts_length(hts* table);
+
+// Return number of shards, and shard number i (0 to hts_num_shards-1),
+// for example to iterate over shards in parallel.
+size_t hts_num_shards(hts* table);
+ht* hts_shard(hts* table, size_t i);
+
+// Grow shards (if needed) so that num_items items spread evenly across
+// them fit without expanding, using one thread per shard up to
+// num_threads. Return true on success, false if out of memory.
+bool hts_reserve(hts* table, size_t num_items, int num_threads);
+
+// Sharded table iterator: create with hts_iterator, iterate with hts_next.
+typedef struct {
+    const char* key;  // current key
+    void* value;      // current value
+
+    // Don't use these fields directly.
+    hts* _table;      // reference to sharded table being iterated
+    size_t _shard;    // current shard number
+    hti _it;          // iterator over current shard
+} htsi;
+
+// Return new sharded table iterator (for use with hts_next).
+htsi hts_iterator(hts* table);
+
+// Move iterator to next item in sharded table, update iterator's key
+// and value to current item, and return true. If there are no more
+// items, return false. Don't call hts_set during iteration.
+bool hts_next(htsi* it);
+
+#endif // _HTSHARD_H
@@ -0,0 +1,128 @@
+// Show bulk operations: clearing an HT_EPOCH table many times, and
+// merging word counts with ht_merge_move
+
+/*
+$ gcc -Wall -O2 -o bulk samples/bulk.c ht.c && ./bulk
+round 1: length 4, cleared 0, stale 0
+round 255: length 4, cleared 0, stale 0
+round 256: length 4, cleared 0, stale 0
+round 257: length 4, cleared 0, stale 0
+round 300: length 4, cleared 0, stale 0
+merged 8 words, left 4, right 5
+the 4
+quick 1
+brown 2
+fox 2
+jumps 1
+over 1
+lazy 1
+dog 1
+*/
+
+#include "../ht.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_ROUNDS 300  // more than 255 clears, so the epoch wraps
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+void* add_counts(const char* key, void* dst_value, void* src_value,
+                 void* arg) {
+    return (void*)((intptr_t)dst_value + (intptr_t)src_value);
+}
+
+// Add count of 1 for each word in words to table.
+void count_words(ht* table, const char** words, size_t num_words) {
+    for (size_t i = 0; i < num_words; i++) {
+        intptr_t count = (intptr_t)ht_get(table, words[i]) + 1;
+        if (ht_set(table, words[i], (void*)count) == NULL) {
+            exit_nomem();
+        }
+    }
+}
+
+int main(void) {
+    // Each round, set the same three keys plus one for the round, then
+    // clear the table. A key from an earlier round (even 256 clears ago,
+    // when the epoch counter has wrapped to the same value) mustn't
+    // come back, and clearing must leave nothing to iterate.
+    ht* table = ht_create_flags(HT_EPOCH);
+    if (table == NULL) {
+        exit_nomem();
+    }
+    const char* keys[] = {"a", "b", "c"};
+    char round_key[16];
+    for (intptr_t round = 1; round <= NUM_ROUNDS; round++) {
+        for (size_t i = 0; i < 3; i++) {
+            if (ht_set(table, keys[i], (void*)round) == NULL) {
+                exit_nomem();
+            }
+        }
+        snprintf(round_key, sizeof(round_key), "round%d", (int)round);
+        if (ht_set(table, round_key, (void*)round) == NULL) {
+            exit_nomem();
+        }
+        size_t length = ht_length(table);
+
+        ht_clear(table);
+        size_t cleared = ht_length(table);
+        hti it = ht_iterator(table);
+        while (ht_next(&it)) {
+            cleared++;
+        }
+        int stale = 0;
+        for (int r = 1; r <= round; r++) {
+            snprintf(round_key, sizeof(round_key), "round%d", r);
+            if (ht_get(table, round_key) != NULL) {
+                stale++;
+            }
+        }
+        for (size_t i = 0; i < 3; i++) {
+            if (ht_get(table, keys[i]) != NULL) {
+                stale++;
+            }
+        }
+
+        if (round == 1 || (round >= 255 && round <= 257) ||
+                round == NUM_ROUNDS) {
+            printf("round %d: length %d, cleared %d, stale %d\n",
+                   (int)round, (int)length, (int)cleared, stale);
+        }
+    }
+    ht_destroy(table);
+
+    // Count each half of a sentence into its own table, then move the
+    // right half's counts into the left's. Both are HT_ORDERED, so the
+    // result iterates in order of first occurrence, whatever the seed.
+    const char* words[] = {"the", "quick", "brown", "fox", "the", "brown",
+                           "fox", "jumps", "over", "the", "lazy", "dog",
+                           "the"};
+    size_t num_words = sizeof(words) / sizeof(words[0]);
+    ht* left = ht_create_flags(HT_ORDERED);
+    ht* right = ht_create_flags(HT_ORDERED);
+    if (left == NULL || right == NULL) {
+        exit_nomem();
+    }
+    count_words(left, words, 7);
+    count_words(right, words + 7, num_words - 7);
+    size_t left_length = ht_length(left);
+    size_t right_length = ht_length(right);
+    if (!ht_merge_move(left, right, add_counts, NULL)) {
+        exit_nomem();
+    }
+
+    printf("merged %d words, left %d, right %d\n", (int)ht_length(left),
+           (int)left_length, (int)right_length);
+    hti it = ht_iterator(left);
+    while (ht_next(&it)) {
+        printf("%s %d\n", it.key, (int)(intptr_t)it.value);
+    }
+    ht_destroy(left);
+    return 0;
+}
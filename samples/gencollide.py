@@ -0,0 +1,45 @@
+# Generate keys whose 64-bit FNV-1a hashes all have the same low 32 bits,
+# so they all land in the same slot (and one long probe run) in any ht
+# of up to 4G slots that's unseeded (HT_SEED=0; with a random seed,
+# which changes FNV-1a's starting state, these keys don't collide). This
+# works because the low bits of the FNV-1a state depend only on the low
+# bits of the previous state and the input byte.
+# For each position, find two 8-letter blocks that take the (low 32 bits
+# of the) state to the same value; any choice of blocks then collides.
+# (Shorter blocks rarely collide, as there are too few rounds of mixing.)
+
+import random
+import sys
+
+if len(sys.argv) < 2:
+    print('usage: gencollide.py num', file=sys.stderr)
+    sys.exit(1)
+
+FNV_OFFSET = 14695981039346656037
+FNV_PRIME = 1099511628211
+MASK = (1 << 32) - 1
+LETTERS = 'abcdefghijklmnopqrstuvwxyz'
+
+def step(state, block):
+    for c in block.encode():
+        state = ((state ^ c) * FNV_PRIME) & MASK
+    return state
+
+num = int(sys.argv[1])
+random.seed(1)  # same keys every time
+pairs = []
+state = FNV_OFFSET & MASK
+while (1 << len(pairs)) < num:
+    seen = {}
+    while True:
+        block = ''.join(random.choice(LETTERS) for _ in range(8))
+        h = step(state, block)
+        other = seen.get(h)
+        if other is not None and other != block:
+            pairs.append((other, block))
+            state = h
+            break
+        seen[h] = block
+
+for i in range(num):
+    print(''.join(pair[(i >> j) & 1] for j, pair in enumerate(pairs)))
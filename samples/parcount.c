@@ -0,0 +1,178 @@
+// Parallel map/reduce over word counts using ht_iterator_part
+
+/*
+
+$ gcc -O2 -Wall -o parcount samples/parcount.c ht.c -lpthread
+$ ./parcount samples/words.txt
+
+Each thread iterates over its own part of the table, "mapping" every
+word to a letter histogram weighted by the word's count. The main thread
+then "reduces" the per-thread histograms into one. The result must be
+the same for every thread count; the time should drop as threads are
+added (up to the number of cores).
+
+*/
+
+#include "../ht.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define MAX_THREADS 16
+
+// Work and result for a single worker thread.
+typedef struct {
+    ht* table;
+    size_t part;
+    size_t num_parts;
+    size_t total;             // sum of counts in this part
+    size_t histogram[256];    // letter frequencies weighted by count
+} job;
+
+void* map_part(void* arg) {
+    job* j = (job*)arg;
+    j->total = 0;
+    memset(j->histogram, 0, sizeof(j->histogram));
+
+    hti it = ht_iterator_part(j->table, j->part, j->num_parts);
+    while (ht_next(&it)) {
+        int count = *(int*)it.value;
+        j->total += count;
+        for (const char* p = it.key; *p; p++) {
+            j->histogram[(unsigned char)*p] += count;
+        }
+    }
+    return NULL;
+}
+
+// Return wall-clock time in seconds (clock() adds up all threads).
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: parcount file\n");
+        return 1;
+    }
+
+    // Read entire file into memory.
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    ht* counts = ht_create();
+    if (counts == NULL) {
+        exit_nomem();
+    }
+
+    for (char* p = contents; *p;) {
+        // Skip whitespace.
+        while (*p && *p <= ' ') {
+            p++;
+        }
+        char* word = p;
+
+        // Find end of word.
+        while (*p && *p > ' ') {
+            p++;
+        }
+        if (*p != 0) {
+            *p = 0;
+            p++;
+        }
+        if (*word == 0) {
+            break;
+        }
+
+        // Look up word.
+        void* value = ht_get(counts, word);
+        if (value != NULL) {
+            // Already exists, increment int that value points to.
+            int* pcount = (int*)value;
+            (*pcount)++;
+            continue;
+        }
+
+        // Word not found, allocate space for new int and set to 1.
+        int* pcount = malloc(sizeof(int));
+        if (pcount == NULL) {
+            exit_nomem();
+        }
+        *pcount = 1;
+        if (ht_set(counts, word, pcount) == NULL) {
+            exit_nomem();
+        }
+    }
+
+    static job jobs[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    int runs = 10;
+    double single_secs = 0;
+
+    for (size_t num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+        size_t total = 0;
+        size_t histogram[256] = {0};
+
+        double start = now();
+        for (int run = 0; run < runs; run++) {
+            // Map: one thread per part of the table.
+            for (size_t t = 0; t < num_threads; t++) {
+                jobs[t].table = counts;
+                jobs[t].part = t;
+                jobs[t].num_parts = num_threads;
+                if (pthread_create(&threads[t], NULL, map_part, &jobs[t]) != 0) {
+                    fprintf(stderr, "can't create thread\n");
+                    return 1;
+                }
+            }
+
+            // Reduce: combine per-part results.
+            total = 0;
+            memset(histogram, 0, sizeof(histogram));
+            for (size_t t = 0; t < num_threads; t++) {
+                pthread_join(threads[t], NULL);
+                total += jobs[t].total;
+                for (int c = 0; c < 256; c++) {
+                    histogram[c] += jobs[t].histogram[c];
+                }
+            }
+        }
+        double elapsed = now() - start;
+        if (num_threads == 1) {
+            single_secs = elapsed;
+        }
+
+        printf("%2lu threads, %d runs: %.03fms (%.2fx), words=%lu e=%lu\n",
+            num_threads, runs, elapsed * 1000, single_secs / elapsed,
+            total, histogram['e']);
+    }
+
+    return 0;
+}
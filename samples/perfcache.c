@@ -0,0 +1,123 @@
+// Performance test of htcache replaying a Zipfian key trace
+
+/*
+
+$ gcc -O2 -Wall -o perfcache samples/perfcache.c htcache.c ht.c -lm
+$ ./perfcache
+
+Each trace entry is looked up with htcache_get; on a miss the item is
+"fetched" and added with htcache_put (which may evict). Keys are drawn
+from 1M distinct keys with Zipf exponent 0.99, a typical web cache
+workload. Time includes gets, puts and evictions.
+
+*/
+
+#include "../htcache.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define NUM_KEYS 1000000
+#define TRACE_LEN 10000000
+#define ZIPF_S 0.99
+
+size_t num_evicted;
+
+void on_evict(const char* key, void* value, void* arg) {
+    num_evicted++;
+}
+
+// Return random 64-bit number (xorshift64*).
+uint64_t rand64(void) {
+    static uint64_t state = 88172645463325252ULL;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+int main(void) {
+    // Generate keys.
+    char** keys = malloc(NUM_KEYS * sizeof(char*));
+    if (keys == NULL) {
+        exit_nomem();
+    }
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        keys[i] = malloc(16);
+        if (keys[i] == NULL) {
+            exit_nomem();
+        }
+        snprintf(keys[i], 16, "key%lu", i);
+    }
+
+    // Build Zipf CDF: key i has weight 1/(i+1)^s.
+    double* cdf = malloc(NUM_KEYS * sizeof(double));
+    if (cdf == NULL) {
+        exit_nomem();
+    }
+    double total = 0;
+    for (size_t i = 0; i < NUM_KEYS; i++) {
+        total += 1.0 / pow((double)(i + 1), ZIPF_S);
+        cdf[i] = total;
+    }
+
+    // Generate trace by binary searching the CDF. Shuffle key ranks
+    // with a multiplier so popular keys aren't also sequential.
+    uint32_t* trace = malloc(TRACE_LEN * sizeof(uint32_t));
+    if (trace == NULL) {
+        exit_nomem();
+    }
+    for (size_t t = 0; t < TRACE_LEN; t++) {
+        double r = (double)(rand64() >> 11) / 9007199254740992.0 * total;
+        size_t low = 0;
+        size_t high = NUM_KEYS - 1;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (cdf[mid] < r) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        trace[t] = (uint32_t)((low * 7919) % NUM_KEYS);
+    }
+
+    int value = 1; // dummy value
+    size_t sizes[] = {NUM_KEYS / 1000, NUM_KEYS / 100, NUM_KEYS / 10};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(size_t); s++) {
+        htcache* cache = htcache_create(sizes[s], on_evict, NULL);
+        if (cache == NULL) {
+            exit_nomem();
+        }
+        num_evicted = 0;
+        size_t hits = 0;
+
+        clock_t start = clock();
+        for (size_t t = 0; t < TRACE_LEN; t++) {
+            const char* key = keys[trace[t]];
+            if (htcache_get(cache, key) != NULL) {
+                hits++;
+                continue;
+            }
+            if (htcache_put(cache, key, &value) == NULL) {
+                exit_nomem();
+            }
+        }
+        clock_t end = clock();
+        double elapsed_ns = (double)(end - start) / CLOCKS_PER_SEC * 1e9;
+
+        printf("cache %7lu items: hit rate %.2f%%, %.1fns/op, %lu evictions\n",
+            sizes[s], (double)hits * 100 / TRACE_LEN, elapsed_ns / TRACE_LEN,
+            num_evicted);
+        htcache_destroy(cache);
+    }
+    return 0;
+}
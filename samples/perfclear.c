@@ -0,0 +1,101 @@
+// Performance comparison of ways to empty a table for reuse: destroy
+// and re-create it, ht_clear, and ht_clear on an HT_EPOCH table
+
+/*
+
+$ gcc -O2 -Wall -o perfclear samples/perfclear.c ht.c
+$ ./perfclear
+
+Each round clears the table and refills it with half a table's worth of
+keys, so "round" includes the refill (and for realloc, re-expanding);
+"clear" is just the time spent emptying the table.
+
+*/
+
+#include "../ht.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+enum { REALLOC, MEMSET, EPOCH };
+const char* method_names[] = {"realloc", "memset ", "epoch  "};
+
+int value = 1; // dummy value
+
+void fill(ht* table, char** keys, size_t num_keys) {
+    for (size_t i = 0; i < num_keys; i++) {
+        if (ht_set(table, keys[i], &value) == NULL) {
+            exit_nomem();
+        }
+    }
+}
+
+int main(void) {
+    size_t slot_counts[] = {1 << 10, 1 << 14, 1 << 17, 1 << 20, 1 << 23,
+                            1 << 24};
+    size_t num_sizes = sizeof(slot_counts) / sizeof(size_t);
+
+    for (size_t s = 0; s < num_sizes; s++) {
+        size_t slots = slot_counts[s];
+        size_t num_keys = slots / 2;
+        int rounds = (int)((1 << 23) / slots);
+        if (rounds < 3) {
+            rounds = 3;
+        }
+        printf("SLOTS: %lu (%lu keys, %d rounds)\n", slots, num_keys, rounds);
+
+        char** keys = malloc(num_keys * sizeof(char*));
+        if (keys == NULL) {
+            exit_nomem();
+        }
+        for (size_t i = 0; i < num_keys; i++) {
+            keys[i] = malloc(24);
+            if (keys[i] == NULL) {
+                exit_nomem();
+            }
+            snprintf(keys[i], 24, "key%lu", i);
+        }
+
+        for (int method = REALLOC; method <= EPOCH; method++) {
+            ht* table = ht_create_flags(method == EPOCH ? HT_EPOCH : 0);
+            if (table == NULL) {
+                exit_nomem();
+            }
+            fill(table, keys, num_keys);
+
+            double clear_secs = 0;
+            clock_t start = clock();
+            for (int round = 0; round < rounds; round++) {
+                clock_t clear_start = clock();
+                if (method == REALLOC) {
+                    ht_destroy(table);
+                    table = ht_create();
+                    if (table == NULL) {
+                        exit_nomem();
+                    }
+                } else {
+                    ht_clear(table);
+                }
+                clear_secs += (double)(clock() - clear_start) / CLOCKS_PER_SEC;
+                fill(table, keys, num_keys);
+            }
+            clock_t end = clock();
+            double round_secs = (double)(end - start) / CLOCKS_PER_SEC;
+            printf("  %s: clear %.06fms, round %.06fms\n", method_names[method],
+                clear_secs * 1000 / rounds, round_secs * 1000 / rounds);
+            ht_destroy(table);
+        }
+
+        for (size_t i = 0; i < num_keys; i++) {
+            free(keys[i]);
+        }
+        free(keys);
+    }
+    return 0;
+}
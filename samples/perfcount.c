@@ -0,0 +1,262 @@
+// Hardware-counter profile of hash table operations (Linux only)
+
+/*
+
+$ gcc -O2 -Wall -o perfcount samples/perfcount.c ht.c
+$ ./perfcount samples/words.txt
+
+Uses perf_event_open to count cycles, instructions, L1 data cache read
+misses, last-level cache misses, data TLB misses and branch misses
+(user space only) around each kind of operation, and prints each
+figure divided by the number of keys the operation touched:
+
+set      - ht_set of every word into a table presized with ht_reserve
+get hit  - ht_get of every word (in file order)
+get miss - ht_get of every word with "!" appended
+iterate  - ht_iterator/ht_next over the full table
+expand   - ht_reserve of a full table to twice its length (one rehash)
+
+Counters that can't be opened (not supported by the CPU or VM, or
+disallowed by /proc/sys/kernel/perf_event_paranoid) are shown as "-",
+so at worst only the ns/key column is filled in. If the kernel has to
+multiplex counters, counts are scaled by the fraction of time each was
+running.
+
+*/
+
+#include "../ht.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define NUM_RUNS 5  // passes for get and iterate (set and expand run once)
+
+#define CACHE_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+typedef struct {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+    int fd;  // -1 if counter couldn't be opened
+} counter;
+
+counter counters[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1},
+    {"instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1},
+    {"L1d-miss", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D), -1},
+    {"LLC-miss", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL), -1},
+    {"dTLB-miss", PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_DTLB), -1},
+    {"br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1},
+};
+
+#define NUM_COUNTERS (sizeof(counters) / sizeof(counters[0]))
+
+// Open all counters for this process (any CPU), initially disabled.
+// Return number opened.
+int open_counters(void) {
+    int num_open = 0;
+    int first_errno = 0;
+    for (size_t c = 0; c < NUM_COUNTERS; c++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counters[c].type;
+        attr.config = counters[c].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counters[c].fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counters[c].fd < 0) {
+            if (first_errno == 0) {
+                first_errno = errno;
+            }
+            continue;
+        }
+        num_open++;
+    }
+    if (num_open < (int)NUM_COUNTERS) {
+        fprintf(stderr, "%d of %d counters unavailable (%s), shown as \"-\"\n",
+                (int)NUM_COUNTERS - num_open, (int)NUM_COUNTERS,
+                strerror(first_errno));
+    }
+    return num_open;
+}
+
+// Return wall-clock time in seconds.
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+double start_time;
+
+void start_counters(void) {
+    for (size_t c = 0; c < NUM_COUNTERS; c++) {
+        if (counters[c].fd >= 0) {
+            ioctl(counters[c].fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters[c].fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    start_time = now();
+}
+
+// Stop counters and print one row of results divided by num_keys.
+void stop_counters(const char* name, size_t num_keys) {
+    double elapsed = now() - start_time;
+    for (size_t c = 0; c < NUM_COUNTERS; c++) {
+        if (counters[c].fd >= 0) {
+            ioctl(counters[c].fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    printf("%-9s %8.1f", name, elapsed * 1e9 / num_keys);
+    for (size_t c = 0; c < NUM_COUNTERS; c++) {
+        // Values are count, time enabled, time running.
+        uint64_t values[3];
+        if (counters[c].fd < 0 ||
+                read(counters[c].fd, values, sizeof(values)) != sizeof(values) ||
+                values[2] == 0) {
+            printf(" %9s", "-");
+            continue;
+        }
+        double count = (double)values[0] * values[1] / values[2];
+        printf(" %9.2f", count / num_keys);
+    }
+    printf("\n");
+}
+
+void* found;
+int value = 1; // dummy value
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: perfcount file\n");
+        return 1;
+    }
+
+    // Read entire file into memory.
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    // Split into words, and make a missing key from each one.
+    char** words = malloc((size / 2 + 1) * sizeof(char*));
+    char** missing = malloc((size / 2 + 1) * sizeof(char*));
+    if (words == NULL || missing == NULL) {
+        exit_nomem();
+    }
+    size_t num_words = 0;
+    for (char* p = contents; *p;) {
+        while (*p && *p <= ' ') {
+            p++;
+        }
+        if (*p == 0) {
+            break;
+        }
+        char* word = p;
+        while (*p && *p > ' ') {
+            p++;
+        }
+        if (*p != 0) {
+            *p = 0;
+            p++;
+        }
+        size_t len = strlen(word);
+        missing[num_words] = malloc(len + 2);
+        if (missing[num_words] == NULL) {
+            exit_nomem();
+        }
+        memcpy(missing[num_words], word, len);
+        strcpy(missing[num_words] + len, "!");
+        words[num_words++] = word;
+    }
+
+    open_counters();
+    printf("%-9s %8s", "per key", "ns");
+    for (size_t c = 0; c < NUM_COUNTERS; c++) {
+        printf(" %9s", counters[c].name);
+    }
+    printf("\n");
+
+    ht* table = ht_create();
+    if (table == NULL || !ht_reserve(table, num_words)) {
+        exit_nomem();
+    }
+    start_counters();
+    for (size_t i = 0; i < num_words; i++) {
+        if (ht_set(table, words[i], &value) == NULL) {
+            exit_nomem();
+        }
+    }
+    stop_counters("set", num_words);
+
+    start_counters();
+    for (int run = 0; run < NUM_RUNS; run++) {
+        for (size_t i = 0; i < num_words; i++) {
+            found = ht_get(table, words[i]);
+        }
+    }
+    stop_counters("get hit", num_words * NUM_RUNS);
+
+    start_counters();
+    for (int run = 0; run < NUM_RUNS; run++) {
+        for (size_t i = 0; i < num_words; i++) {
+            found = ht_get(table, missing[i]);
+        }
+    }
+    stop_counters("get miss", num_words * NUM_RUNS);
+
+    size_t num_items = 0;
+    start_counters();
+    for (int run = 0; run < NUM_RUNS; run++) {
+        hti it = ht_iterator(table);
+        while (ht_next(&it)) {
+            found = it.value;
+            num_items++;
+        }
+    }
+    stop_counters("iterate", num_items);
+
+    start_counters();
+    if (!ht_reserve(table, ht_length(table) * 2)) {
+        exit_nomem();
+    }
+    stop_counters("expand", ht_length(table));
+
+    ht_destroy(table);
+    return 0;
+}
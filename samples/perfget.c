@@ -2,11 +2,31 @@
 
 // See perftest.sh for results
 
+/*
+
+With -n, compare looking up the same number of 64-bit integer IDs (as
+keys in an ht64 table) and their decimal-string forms (in an ht table,
+formatting each ID before looking it up, as callers must):
+
+$ gcc -O2 -Wall -o perfget samples/perfget.c ht.c ht64.c
+$ ./perfget -n samples/words.txt
+
+With -m, time lookups where a given fraction of the keys are missing
+(each word with "!" appended, which isn't in words.txt), in a plain
+table and in an HT_FILTER table:
+
+$ ./perfget -m samples/words.txt
+
+*/
+
 #include "../ht.h"
+#include "../ht64.h"
 
 #include <ctype.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 void exit_nomem(void) {
@@ -16,9 +36,144 @@ void exit_nomem(void) {
 
 void* found;
 
+// Time getting num_keys 64-bit IDs, via ht64 and via decimal strings.
+void numeric_gets(size_t num_keys) {
+    // Make pseudo-random IDs (splitmix64 sequence).
+    uint64_t* ids = malloc(num_keys * sizeof(uint64_t));
+    if (ids == NULL) {
+        exit_nomem();
+    }
+    uint64_t state = 0;
+    for (size_t i = 0; i < num_keys; i++) {
+        state += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        ids[i] = z ^ (z >> 31);
+    }
+
+    int value = 1; // dummy value
+    ht* strings = ht_create();
+    ht64* ints = ht64_create();
+    if (strings == NULL || ints == NULL) {
+        exit_nomem();
+    }
+    char buf[21];
+    for (size_t i = 0; i < num_keys; i++) {
+        snprintf(buf, sizeof(buf), "%llu", (unsigned long long)ids[i]);
+        if (ht_set(strings, buf, &value) == NULL ||
+                !ht64_set(ints, ids[i], &value)) {
+            exit_nomem();
+        }
+    }
+
+    int runs = 10;
+    clock_t start = clock();
+    for (int run=0; run<runs; run++) {
+        for (size_t i=0; i<num_keys; i++) {
+            snprintf(buf, sizeof(buf), "%llu", (unsigned long long)ids[i]);
+            found = ht_get(strings, buf);
+        }
+    }
+    clock_t end = clock();
+    double elapsed_ms = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+    printf("%d runs getting %lu string IDs: %.03fms\n", runs, num_keys, elapsed_ms);
+
+    start = clock();
+    for (int run=0; run<runs; run++) {
+        for (size_t i=0; i<num_keys; i++) {
+            found = ht64_get(ints, ids[i]);
+        }
+    }
+    end = clock();
+    elapsed_ms = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+    printf("%d runs getting %lu u64 IDs: %.03fms\n", runs, num_keys, elapsed_ms);
+
+    ht_destroy(strings);
+    ht64_destroy(ints);
+    free(ids);
+}
+
+// Time getting num_keys keys at various miss ratios, with and without a
+// Bloom filter (HT_FILTER).
+void miss_gets(const char** keys, size_t num_keys) {
+    int value = 1; // dummy value
+    ht* plain = ht_create();
+    ht* filtered = ht_create_flags(HT_FILTER);
+    if (plain == NULL || filtered == NULL) {
+        exit_nomem();
+    }
+    for (size_t i = 0; i < num_keys; i++) {
+        if (ht_set(plain, keys[i], &value) == NULL ||
+                ht_set(filtered, keys[i], &value) == NULL) {
+            exit_nomem();
+        }
+    }
+
+    // Make a missing key for each key.
+    char** missing = malloc(num_keys * sizeof(char*));
+    const char** lookups = malloc(num_keys * sizeof(char*));
+    if (missing == NULL || lookups == NULL) {
+        exit_nomem();
+    }
+    for (size_t i = 0; i < num_keys; i++) {
+        size_t len = strlen(keys[i]);
+        missing[i] = malloc(len + 2);
+        if (missing[i] == NULL) {
+            exit_nomem();
+        }
+        memcpy(missing[i], keys[i], len);
+        strcpy(missing[i] + len, "!");
+        if (ht_get(plain, missing[i]) != NULL) {
+            fprintf(stderr, "missing key %s is present\n", missing[i]);
+            exit(1);
+        }
+    }
+
+    int ratios[] = {0, 50, 80, 95, 100};
+    for (size_t r = 0; r < sizeof(ratios) / sizeof(int); r++) {
+        // Spread the misses evenly: ratio% of every 20 lookups.
+        for (size_t i = 0; i < num_keys; i++) {
+            bool miss = (int)(i % 20) < ratios[r] / 5;
+            lookups[i] = miss ? missing[i] : keys[i];
+        }
+
+        double elapsed_ms[2];
+        for (int filter = 0; filter <= 1; filter++) {
+            ht* table = filter ? filtered : plain;
+            int runs = 10;
+            clock_t start = clock();
+            for (int run=0; run<runs; run++) {
+                for (size_t i=0; i<num_keys; i++) {
+                    found = ht_get(table, lookups[i]);
+                }
+            }
+            clock_t end = clock();
+            elapsed_ms[filter] = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+        }
+        printf("10 runs getting %lu keys, %3d%% missing: plain %.03fms, "
+               "filter %.03fms (%.2fx)\n", num_keys, ratios[r],
+               elapsed_ms[0], elapsed_ms[1], elapsed_ms[0] / elapsed_ms[1]);
+    }
+
+    for (size_t i = 0; i < num_keys; i++) {
+        free(missing[i]);
+    }
+    free(missing);
+    free(lookups);
+    ht_destroy(plain);
+    ht_destroy(filtered);
+}
+
 int main(int argc, char **argv) {
+    bool numeric = argc >= 2 && strcmp(argv[1], "-n") == 0;
+    bool misses = argc >= 2 && strcmp(argv[1], "-m") == 0;
+    if (numeric || misses) {
+        argc--;
+        argv++;
+    }
     if (argc < 2) {
-        fprintf(stderr, "usage: perftest file\n");
+        fprintf(stderr, "usage: perftest [-n | -m] file\n");
         return 1;
     }
 
@@ -84,6 +239,11 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (numeric) {
+        numeric_gets(ht_length(counts));
+        return 0;
+    }
+
     // Copy keys to array
     const char** keys = malloc(ht_length(counts) * sizeof(char*));
     if (keys == NULL) {
@@ -95,6 +255,10 @@ int main(int argc, char **argv) {
         keys[i] = it.key;
         i++;
     }
+    if (misses) {
+        miss_gets(keys, ht_length(counts));
+        return 0;
+    }
 
     int runs = 10;
     clock_t start = clock();
@@ -0,0 +1,147 @@
+// Performance comparison of string interning: ht_set vs ht_intern
+
+/*
+
+$ gcc -O2 -Wall -o perfintern samples/perfintern.c samples/tokenize.c ht.c
+$ ./perfintern samples/words.txt
+
+Each run interns every word in the file twice: the "new" pass adds
+them (words.txt has no duplicates, so all are misses), then the "again"
+pass finds them all. The "set" line interns the way you had to before
+ht_intern: copy the word to a NUL-terminated buffer and call ht_set with
+a dummy value, as ht_set returns the existing key if present. The "free"
+figure is the ht_destroy time, which for HT_ARENA tables frees a few
+chunks instead of every key.
+
+*/
+
+#include "../ht.h"
+#include "tokenize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define NUM_RUNS 5
+
+token* words;
+size_t num_words;
+int value = 1; // dummy value
+
+// Intern with ht_set, after copying the word to a NUL-terminated buffer.
+const char* set(ht* table, const char* str, size_t len) {
+    char buf[256];
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    const char* canonical = ht_set(table, buf, &value);
+    if (canonical == NULL) {
+        exit_nomem();
+    }
+    return canonical;
+}
+
+// Intern with a single ht_intern call.
+const char* intern(ht* table, const char* str, size_t len) {
+    const char* canonical = ht_intern(table, str, len);
+    if (canonical == NULL) {
+        exit_nomem();
+    }
+    return canonical;
+}
+
+typedef const char* (*intern_func)(ht* table, const char* str, size_t len);
+
+void run(const char* name, intern_func f, int flags) {
+    double new_ns = 0;
+    double again_ns = 0;
+    double free_ns = 0;
+    const char** canonicals = malloc(num_words * sizeof(char*));
+    if (canonicals == NULL) {
+        exit_nomem();
+    }
+
+    for (int run = 0; run < NUM_RUNS; run++) {
+        ht* table = ht_create_flags(flags);
+        if (table == NULL) {
+            exit_nomem();
+        }
+
+        clock_t start = clock();
+        for (size_t i = 0; i < num_words; i++) {
+            canonicals[i] = f(table, words[i].start, words[i].length);
+        }
+        clock_t middle = clock();
+        for (size_t i = 0; i < num_words; i++) {
+            if (f(table, words[i].start, words[i].length) != canonicals[i]) {
+                fprintf(stderr, "%s: pointers differ!\n", name);
+                exit(1);
+            }
+        }
+        clock_t end = clock();
+        ht_destroy(table);
+        clock_t freed = clock();
+
+        new_ns += (double)(middle - start) / CLOCKS_PER_SEC * 1e9;
+        again_ns += (double)(end - middle) / CLOCKS_PER_SEC * 1e9;
+        free_ns += (double)(freed - end) / CLOCKS_PER_SEC * 1e9;
+    }
+    free(canonicals);
+
+    double ops = (double)num_words * NUM_RUNS;
+    printf("%s: new %.1fns/op, again %.1fns/op, free %.1fns/op\n",
+        name, new_ns / ops, again_ns / ops, free_ns / ops);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: perfintern file\n");
+        return 1;
+    }
+
+    // Read entire file into memory.
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    // Split into words (slices of contents, not NUL-terminated).
+    words = malloc((size / 2 + 1) * sizeof(token));
+    if (words == NULL) {
+        exit_nomem();
+    }
+    tokenizer t = tok_init(contents, size);
+    while (tok_next(&t, &words[num_words])) {
+        num_words++;
+    }
+    printf("%lu words\n", num_words);
+
+    run("set           ", set, 0);
+    run("intern        ", intern, 0);
+    run("intern arena  ", intern, HT_ARENA);
+    run("intern ordered", intern, HT_ORDERED | HT_ARENA);
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Performance comparison of merging word-count tables: naive loop vs
+// ht_merge and ht_merge_move
+
+/*
+
+$ gcc -O2 -Wall -o perfmerge samples/perfmerge.c ht.c
+$ ./perfmerge samples/words.txt
+
+Merges a table counting every word in the file into another one, with
+the same keys ("same") or different keys ("new", each word with "!"
+appended). The naive loop calls ht_get and ht_set for each key, as
+callers had to before ht_merge. All tables are created with
+ht_create_like, so they hash the same way and merging HT_ORDERED tables
+reuses their saved hashes. Counts are stored directly in the value
+pointers, so only the merging is timed. Tables are copied fresh
+(untimed) for each run.
+
+*/
+
+#include "../ht.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define NUM_RUNS 5
+
+void* add_counts(const char* key, void* dst_value, void* src_value,
+                 void* arg) {
+    return (void*)((intptr_t)dst_value + (intptr_t)src_value);
+}
+
+// Merge src into dst one key at a time.
+void naive_merge(ht* dst, ht* src) {
+    hti it = ht_iterator(src);
+    while (ht_next(&it)) {
+        intptr_t count = (intptr_t)ht_get(dst, it.key);
+        count += (intptr_t)it.value;
+        if (ht_set(dst, it.key, (void*)count) == NULL) {
+            exit_nomem();
+        }
+    }
+    ht_destroy(src);
+}
+
+// Return sum of counts in table.
+intptr_t total(ht* table) {
+    intptr_t sum = 0;
+    hti it = ht_iterator(table);
+    while (ht_next(&it)) {
+        sum += (intptr_t)it.value;
+    }
+    return sum;
+}
+
+// Time each way of merging copies of src into copies of dst.
+void run(const char* name, ht* dst, ht* src) {
+    intptr_t expected = total(dst) + total(src);
+    printf("%s:", name);
+    for (int method = 0; method < 3; method++) {
+        double elapsed_ms = 0;
+        for (int run = 0; run < NUM_RUNS; run++) {
+            ht* d = ht_copy(dst);
+            ht* s = ht_copy(src);
+            if (d == NULL || s == NULL) {
+                exit_nomem();
+            }
+
+            clock_t start = clock();
+            if (method == 0) {
+                naive_merge(d, s);
+            } else if (method == 1) {
+                if (!ht_merge(d, s, add_counts, NULL)) {
+                    exit_nomem();
+                }
+                ht_destroy(s);
+            } else {
+                if (!ht_merge_move(d, s, add_counts, NULL)) {
+                    exit_nomem();
+                }
+            }
+            clock_t end = clock();
+            elapsed_ms += (double)(end - start) / CLOCKS_PER_SEC * 1000;
+
+            if (total(d) != expected) {
+                fprintf(stderr, "%s: wrong total counts\n", name);
+                exit(1);
+            }
+            ht_destroy(d);
+        }
+        const char* names[] = {"naive", "merge", "merge_move"};
+        printf(" %s %.03fms%s", names[method], elapsed_ms / NUM_RUNS,
+               method < 2 ? "," : "\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: perfmerge file\n");
+        return 1;
+    }
+
+    // Read entire file into memory.
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    int layouts[] = {0, HT_ORDERED};
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(int); l++) {
+        // Count words into three tables: words, words again, words+"!".
+        ht* counts = ht_create_flags(layouts[l]);
+        ht* same = ht_create_like(counts);
+        ht* different = ht_create_like(counts);
+        if (counts == NULL || same == NULL || different == NULL) {
+            exit_nomem();
+        }
+        char word[102];
+        FILE* words = fmemopen(contents, size, "r");
+        if (words == NULL) {
+            exit_nomem();
+        }
+        while (fscanf(words, "%100s", word) != EOF) {
+            intptr_t count = (intptr_t)ht_get(counts, word) + 1;
+            if (ht_set(counts, word, (void*)count) == NULL ||
+                    ht_set(same, word, (void*)count) == NULL) {
+                exit_nomem();
+            }
+            strcat(word, "!");
+            if (ht_set(different, word, (void*)count) == NULL) {
+                exit_nomem();
+            }
+        }
+        fclose(words);
+
+        const char* layout = layouts[l] & HT_ORDERED ? "ordered" : "plain  ";
+        printf("%lu keys, %s ", ht_length(counts), layout);
+        run("same", counts, same);
+        printf("%lu keys, %s ", ht_length(counts), layout);
+        run("new ", counts, different);
+
+        ht_destroy(counts);
+        ht_destroy(same);
+        ht_destroy(different);
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Performance comparison of read-mostly lookups: ht behind a read-write
+// lock vs htrcu, with many readers and one writer
+
+/*
+
+$ gcc -O2 -Wall -o perfrcu samples/perfrcu.c htrcu.c ht.c -lpthread
+$ ./perfrcu samples/words.txt
+
+Reader threads look up every word in turn for a second each run, while
+a writer thread sets one key halfway through the run. That's the
+read-mostly case htrcu is for (a few writes a minute, like a config or
+routing table) squeezed into a short run, but still paying for one
+table copy per run. Reads per second should scale with the number of
+reader threads for htrcu (up to the number of cores), while the lock's
+shared counter limits rwlock.
+
+Use -w to write every given number of seconds instead (the first write
+is after half that, or halfway through the run if sooner). Each htrcu
+write copies the whole table, so with frequent writes (say -w 0.1) on
+machines with few cores, the writer's copies take noticeable time away
+from the readers.
+
+*/
+
+#include "../htrcu.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define MAX_READERS 16
+#define RUN_SECS 1.0
+#define WRITE_SECS 20.0  // default seconds between writes (one per run)
+
+const char** keys;
+size_t num_keys;
+int value = 1; // dummy value
+
+ht* locked_table;
+pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+htrcu* rcu_table;
+atomic_bool use_rcu;
+atomic_bool stop;
+double write_secs = WRITE_SECS;
+double run_start;  // start time of current run
+int num_writes;    // writes in current run
+
+// Return wall-clock time in seconds.
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+void* reader(void* arg) {
+    size_t* pcount = (size_t*)arg;
+    size_t count = 0;
+    size_t found = 0;
+    bool rcu = atomic_load(&use_rcu);
+    htrcu_reader* registration = NULL;
+    if (rcu) {
+        registration = htrcu_register(rcu_table);
+        if (registration == NULL) {
+            exit_nomem();
+        }
+    }
+
+    size_t i = (size_t)pcount % num_keys;  // start threads at different keys
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        for (int n = 0; n < 1024; n++) {
+            if (rcu) {
+                found += htrcu_get(rcu_table, keys[i]) != NULL;
+            } else {
+                pthread_rwlock_rdlock(&rwlock);
+                found += ht_get(locked_table, keys[i]) != NULL;
+                pthread_rwlock_unlock(&rwlock);
+            }
+            i++;
+            if (i >= num_keys) {
+                i = 0;
+            }
+        }
+        count += 1024;
+        if (rcu) {
+            htrcu_quiescent(registration);
+        }
+    }
+
+    if (rcu) {
+        htrcu_unregister(registration);
+    }
+    if (found != count) {
+        fprintf(stderr, "missing keys!\n");
+        exit(1);
+    }
+    *pcount = count;
+    return NULL;
+}
+
+// Set a key every write_secs seconds, starting after half of that (or
+// halfway through the run if sooner), till the run stops. Sleeps in
+// short steps so it stops promptly.
+void* writer(void* arg) {
+    char key[32];
+    double first = write_secs < RUN_SECS ? write_secs : RUN_SECS;
+    double next = run_start + first / 2;
+    while (!atomic_load(&stop)) {
+        double wait = next - now();
+        if (wait > 0) {
+            usleep((useconds_t)((wait < 0.01 ? wait : 0.01) * 1e6));
+            continue;
+        }
+        next += write_secs;
+
+        snprintf(key, sizeof(key), "config%d", num_writes % 100);
+        num_writes++;
+        if (atomic_load(&use_rcu)) {
+            if (!htrcu_set(rcu_table, key, &value)) {
+                exit_nomem();
+            }
+        } else {
+            pthread_rwlock_wrlock(&rwlock);
+            if (ht_set(locked_table, key, &value) == NULL) {
+                exit_nomem();
+            }
+            pthread_rwlock_unlock(&rwlock);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            write_secs = atof(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL || write_secs <= 0) {
+        fprintf(stderr, "usage: perfrcu [-w secs] file\n");
+        return 1;
+    }
+
+    // Read entire file into memory.
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    // Split into words and load both tables.
+    keys = malloc((size / 2 + 1) * sizeof(char*));
+    if (keys == NULL) {
+        exit_nomem();
+    }
+    ht* initial = ht_create();
+    locked_table = ht_create();
+    if (initial == NULL || locked_table == NULL) {
+        exit_nomem();
+    }
+    for (char* p = contents; *p;) {
+        while (*p && *p <= ' ') {
+            p++;
+        }
+        if (*p == 0) {
+            break;
+        }
+        char* word = p;
+        while (*p && *p > ' ') {
+            p++;
+        }
+        if (*p != 0) {
+            *p = 0;
+            p++;
+        }
+        keys[num_keys++] = word;
+        if (ht_set(initial, word, &value) == NULL ||
+                ht_set(locked_table, word, &value) == NULL) {
+            exit_nomem();
+        }
+    }
+    rcu_table = htrcu_create(initial);
+    if (rcu_table == NULL) {
+        exit_nomem();
+    }
+
+    for (int rcu = 0; rcu <= 1; rcu++) {
+        atomic_store(&use_rcu, rcu);
+        double single_rate = 0;
+        for (int num_readers = 1; num_readers <= MAX_READERS; num_readers *= 2) {
+            pthread_t threads[MAX_READERS + 1];
+            size_t counts[MAX_READERS];
+            atomic_store(&stop, false);
+            num_writes = 0;
+
+            run_start = now();
+            for (int t = 0; t < num_readers; t++) {
+                pthread_create(&threads[t], NULL, reader, &counts[t]);
+            }
+            pthread_create(&threads[num_readers], NULL, writer, NULL);
+            usleep((useconds_t)(RUN_SECS * 1e6));
+            atomic_store(&stop, true);
+            size_t total = 0;
+            for (int t = 0; t < num_readers; t++) {
+                pthread_join(threads[t], NULL);
+                total += counts[t];
+            }
+            pthread_join(threads[num_readers], NULL);
+            double elapsed = now() - run_start;
+
+            double rate = (double)total / elapsed;
+            if (num_readers == 1) {
+                single_rate = rate;
+            }
+            printf("%s %2d readers: %.1fM reads/s (%.2fx), %d writes\n",
+                rcu ? "htrcu " : "rwlock", num_readers, rate / 1e6,
+                rate / single_rate, num_writes);
+        }
+    }
+
+    htrcu_synchronize(rcu_table);
+    htrcu_destroy(rcu_table);
+    ht_destroy(locked_table);
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Peak memory and worst-case insert latency: single ht vs sharded hts
+
+/*
+
+$ gcc -O2 -Wall -o perfshard samples/perfshard.c htshard.c ht.c -lpthread
+$ ./perfshard 10000000 50000000 100000000 200000000
+
+For each number of keys, inserts that many keys into a single table and
+into sharded tables (16 and 256 shards), each in a forked child process
+so the peak memory (max RSS) figures are independent. The "reserve"
+line presizes all shards in parallel with hts_reserve first.
+
+*/
+
+#include "../htshard.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+// Return wall-clock time in seconds.
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int value = 1; // dummy value
+
+// Insert num_keys keys into table with given number of shard bits (or
+// a plain ht if shard_bits is negative), and print results.
+void run(size_t num_keys, int shard_bits, bool reserve) {
+    ht* single = NULL;
+    hts* sharded = NULL;
+    if (shard_bits < 0) {
+        single = ht_create();
+    } else {
+        sharded = hts_create(shard_bits, 0);
+    }
+    if (single == NULL && sharded == NULL) {
+        exit_nomem();
+    }
+
+    double start = now();
+    if (reserve) {
+        int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (!hts_reserve(sharded, num_keys, num_threads)) {
+            exit_nomem();
+        }
+    }
+    double reserved = now();
+
+    char key[32];
+    double max_latency = 0;
+    for (size_t i = 0; i < num_keys; i++) {
+        snprintf(key, sizeof(key), "key%lu", i);
+        double before = now();
+        const char* p = single != NULL ? ht_set(single, key, &value)
+                                       : hts_set(sharded, key, &value);
+        double latency = now() - before;
+        if (p == NULL) {
+            exit_nomem();
+        }
+        if (latency > max_latency) {
+            max_latency = latency;
+        }
+    }
+    double end = now();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    char name[32];
+    if (single != NULL) {
+        snprintf(name, sizeof(name), "single ht");
+    } else {
+        snprintf(name, sizeof(name), "%d shards%s", 1 << shard_bits,
+                 reserve ? "+reserve" : "");
+    }
+    printf("  %-18s: total %.03fs, reserve %.03fs, worst insert %.03fms, "
+           "peak RSS %.1fMB\n", name, end - start, reserved - start,
+           max_latency * 1000, (double)usage.ru_maxrss / 1024);
+}
+
+int main(int argc, char** argv) {
+    size_t default_sizes[] = {10000000};
+    size_t num_sizes = argc > 1 ? (size_t)(argc - 1) : 1;
+
+    for (size_t s = 0; s < num_sizes; s++) {
+        size_t num_keys = argc > 1 ? (size_t)atol(argv[s + 1])
+                                   : default_sizes[s];
+        printf("KEYS: %lu\n", num_keys);
+        fflush(stdout);
+
+        int configs[][2] = {{-1, 0}, {4, 0}, {8, 0}, {8, 1}};
+        for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                fprintf(stderr, "can't fork\n");
+                return 1;
+            }
+            if (pid == 0) {
+                run(num_keys, configs[c][0], configs[c][1]);
+                fflush(stdout);
+                _exit(0);  // skip freeing, just measuring
+            }
+            int status;
+            waitpid(pid, &status, 0);
+        }
+    }
+    return 0;
+}
@@ -40,13 +40,19 @@
 # setting 466550 keys: 207.069321ms
 # MINIMUM TIME: 191.7ms
 
+# perfset - C version, keys from gencollide.py (all keys in one slot
+# with HT_SEED=0; with a random seed they spread out like any others)
+# setting 466550 keys: 568.258000000ms
+# (20000 of these keys took 2259.566ms before ht switched to SipHash on
+# long probes, growing quadratically with the number of keys)
+
 # NOTE - words.txt is from here (public domain):
 # https://github.com/dwyl/english-words/
 
 set -e
 
 echo 'perfget - C version'
-gcc -Wall -O2 -o perfget-c samples/perfget.c ht.c
+gcc -Wall -O2 -o perfget-c samples/perfget.c ht.c ht64.c
 ./perfget-c samples/words.txt
 ./perfget-c samples/words.txt
 ./perfget-c samples/words.txt
@@ -86,3 +92,7 @@ go build -o perfset-go samples/perfset.go
 ./perfset-go samples/words.txt 
 ./perfset-go samples/words.txt 
 ./perfset-go samples/words.txt 
+
+echo 'perfset - C version, colliding keys'
+python3 samples/gencollide.py 466550 >samples/collide.txt
+HT_SEED=0 ./perfset-c samples/collide.txt  # keys only collide with this seed
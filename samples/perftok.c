@@ -0,0 +1,182 @@
+// Performance comparison of word tokenizers: scanf, byte loop, SIMD
+
+/*
+
+$ gcc -O2 -Wall -o perftok samples/perftok.c samples/tokenize.c ht.c
+$ ./perftok samples/words.txt
+
+Add -mavx2 to use 32-byte AVX2 compares instead of 16-byte SSE2 ones.
+The "tokenize" lines just split the input into words; the "count"
+lines also count the words into a table (as in perfset.c).
+
+*/
+
+#include "../ht.h"
+#include "tokenize.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+size_t num_words;
+size_t total_len;
+
+void count_word(ht* counts, const char* word) {
+    // Look up word.
+    void* value = ht_get(counts, word);
+    if (value != NULL) {
+        // Already exists, increment int that value points to.
+        int* pcount = (int*)value;
+        (*pcount)++;
+        return;
+    }
+
+    // Word not found, allocate space for new int and set to 1.
+    int* pcount = malloc(sizeof(int));
+    if (pcount == NULL) {
+        exit_nomem();
+    }
+    *pcount = 1;
+    if (ht_set(counts, word, pcount) == NULL) {
+        exit_nomem();
+    }
+}
+
+void free_counts(ht* counts) {
+    hti it = ht_iterator(counts);
+    while (ht_next(&it)) {
+        free(it.value);
+    }
+    ht_destroy(counts);
+}
+
+// Tokenize with scanf("%100s"), as stats.c does.
+void scanf_words(char* contents, size_t size, ht* counts) {
+    FILE* f = fmemopen(contents, size, "r");
+    if (f == NULL) {
+        exit_nomem();
+    }
+    char word[101];
+    while (fscanf(f, "%100s", word) != EOF) {
+        num_words++;
+        total_len += strlen(word);
+        if (counts != NULL) {
+            count_word(counts, word);
+        }
+    }
+    fclose(f);
+}
+
+// Tokenize a byte at a time, as perfset.c does.
+void loop_words(char* contents, size_t size, ht* counts) {
+    char* end = contents + size;
+    for (char* p = contents; p < end;) {
+        // Skip whitespace.
+        while (p < end && (unsigned char)*p <= ' ') {
+            p++;
+        }
+        if (p >= end) {
+            break;
+        }
+        char* word = p;
+
+        // Find end of word.
+        while (p < end && (unsigned char)*p > ' ') {
+            p++;
+        }
+        num_words++;
+        total_len += p - word;
+        if (counts != NULL) {
+            *p = 0;
+            count_word(counts, word);
+            *p = ' ';
+        }
+        p++;
+    }
+}
+
+// Tokenize with tokenize.c's SIMD tokenizer.
+void simd_words(char* contents, size_t size, ht* counts) {
+    tokenizer t = tok_init(contents, size);
+    token tok;
+    while (tok_next(&t, &tok)) {
+        num_words++;
+        total_len += tok.length;
+        if (counts != NULL) {
+            char* end = (char*)tok.start + tok.length;
+            char c = *end;
+            *end = 0;
+            count_word(counts, tok.start);
+            *end = c;
+        }
+    }
+}
+
+typedef void (*words_func)(char* contents, size_t size, ht* counts);
+
+void run(const char* name, words_func f, char* contents, size_t size,
+         bool count) {
+    int runs = count ? 3 : 10;
+    num_words = 0;
+    total_len = 0;
+    clock_t start = clock();
+    for (int run = 0; run < runs; run++) {
+        ht* counts = NULL;
+        if (count) {
+            counts = ht_create();
+            if (counts == NULL) {
+                exit_nomem();
+            }
+        }
+        f(contents, size, counts);
+        if (count) {
+            free_counts(counts);
+        }
+    }
+    clock_t end = clock();
+    double elapsed_ms = (double)(end - start) / CLOCKS_PER_SEC * 1000 / runs;
+    printf("%s %s: %.03fms per run (%lu words, %lu bytes)\n",
+        count ? "count   " : "tokenize", name, elapsed_ms,
+        num_words / runs, total_len / runs);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: perftok file\n");
+        return 1;
+    }
+
+    // Read entire file into memory (with a spare byte after it).
+    FILE* f = fopen(argv[1], "rb");
+    if (f == NULL) {
+        fprintf(stderr, "can't open file: %s\n", argv[1]);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* contents = (char*)malloc(size + 1);
+    if (contents == NULL) {
+        exit_nomem();
+    }
+    size_t nread = fread(contents, 1, size, f);
+    if ((long)nread != size) {
+        fprintf(stderr, "read %ld bytes instead of %ld", (long)nread, size);
+        return 1;
+    }
+    fclose(f);
+    contents[size] = 0;
+
+    for (int count = 0; count <= 1; count++) {
+        run("scanf", scanf_words, contents, size, count);
+        run("loop ", loop_words, contents, size, count);
+        run("simd ", simd_words, contents, size, count);
+    }
+    return 0;
+}
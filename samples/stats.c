@@ -9,6 +9,30 @@ len=466550 cap=1048576 avgprobe=1.402
 $ ./stats <samples/similar.txt
 len=466550 cap=1048576 avgprobe=1.378
 
+Use -o to build an HT_ORDERED table, and -i to also time 10 iteration
+passes over the table (a sequential scan of the items when ordered):
+
+$ ./stats -i <samples/similar.txt
+len=466550 cap=1048576 avgprobe=1.378
+iterate 10 runs: 172.560ms
+$ ./stats -o -i <samples/similar.txt
+len=466550 cap=1048576 avgprobe=1.378
+iterate 10 runs: 46.121ms
+
+Use -c to build an HT_COMPACT table instead, and -m to also show the
+table's memory use (slots and keys, not the int values or malloc
+overhead, which maxrss does include) and time 10 passes of getting
+every key:
+
+$ ./stats -m <samples/similar.txt
+len=466550 cap=1048576 avgprobe=1.378
+mem=21798289 bytes (46.7 per key) maxrss=63.9MB
+get 10 runs: 431.091ms
+$ ./stats -c -m <samples/similar.txt
+len=466550 cap=1048576 avgprobe=1.378
+mem=19919664 bytes (42.7 per key) maxrss=52.2MB
+get 10 runs: 355.539ms
+
 */
 
 #include "../ht.h"
@@ -18,6 +42,8 @@ len=466550 cap=1048576 avgprobe=1.378
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <time.h>
 
 void exit_nomem(void) {
     fprintf(stderr, "out of memory\n");
@@ -30,30 +56,86 @@ typedef struct {
     void* value;
 } ht_entry;
 
+typedef struct {
+    const char* key;
+    void* value;
+    uint64_t hash;
+} ht_item;
+
+typedef struct ht_chunk {
+    struct ht_chunk* next;
+    size_t size;
+    size_t used;
+    char data[];
+} ht_chunk;
+
+typedef struct {
+    uint32_t offset;
+    uint32_t tag;
+} ht_slot;
+
 struct ht {
     ht_entry* entries;  // hash slots
     size_t capacity;    // size of _entries array
     size_t length;      // number of items in hash table
+    uint8_t* epochs;    // slot generations (HT_EPOCH only, else NULL)
+    uint8_t epoch;      // current generation (slots from others are empty)
+    ht_item* items;     // dense items (HT_ORDERED only, else NULL)
+    uint32_t* slots;    // HT_ORDERED hash slots: item index+1, 0 if empty
+    bool keyed;         // true if hashing with SipHash (under attack)
+    uint64_t sip_key[2];  // random per-table key for SipHash
+    bool arena;         // true if keys are stored in chunks (HT_ARENA)
+    ht_chunk* chunks;   // most recent arena chunk first, or NULL
+    uint64_t* filter;   // Bloom filter words (HT_FILTER only, else NULL)
+    ht_slot* compact;   // HT_COMPACT hash slots, else NULL
+    ht_chunk** blocks;  // HT_COMPACT arena chunks, in order of allocation
+    size_t num_blocks;  // number of chunks in blocks
+    uint64_t seed;      // random per-table seed mixed into FNV-1a
 };
 
-#define FNV_OFFSET 14695981039346656037UL
-#define FNV_PRIME 1099511628211UL
+#define BLOCK_BITS 17
 
-static uint64_t hash_key(const char* key) {
-    uint64_t hash = FNV_OFFSET;
-    for (const char* p = key; *p; p++) {
-        hash ^= (uint64_t)(unsigned char)(*p);
-        hash *= FNV_PRIME;
-    }
-    return hash;
+static inline char* compact_record(ht* table, uint32_t offset) {
+    offset--;
+    return table->blocks[offset >> BLOCK_BITS]->data +
+        (size_t)(offset & ((1 << BLOCK_BITS) - 1)) * 8;
 }
 
 // Copied from ht_get, but return probe length instead of value.
 size_t get_probe_len(ht* table, const char* key) {
-    uint64_t hash = hash_key(key);
+    uint64_t hash = table->keyed
+        ? ht_siphash(table->sip_key, key, strlen(key))
+        : ht_hash(table->seed, key);
     size_t index = (size_t)(hash & (uint64_t)(table->capacity - 1));
 
     size_t probe_len = 0;
+    if (table->slots != NULL) {
+        while (table->slots[index] != 0) {
+            probe_len++;
+            if (strcmp(key, table->items[table->slots[index] - 1].key) == 0) {
+                return probe_len;
+            }
+            index++;
+            if (index >= table->capacity) {
+                index = 0;
+            }
+        }
+        return probe_len;
+    }
+    if (table->compact != NULL) {
+        while (table->compact[index].offset != 0) {
+            probe_len++;
+            char* record = compact_record(table, table->compact[index].offset);
+            if (strcmp(key, record + 8) == 0) {
+                return probe_len;
+            }
+            index++;
+            if (index >= table->capacity) {
+                index = 0;
+            }
+        }
+        return probe_len;
+    }
     while (table->entries[index].key != NULL) {
         probe_len++;
         if (strcmp(key, table->entries[index].key) == 0) {
@@ -67,8 +149,26 @@ size_t get_probe_len(ht* table, const char* key) {
     return probe_len;
 }
 
-int main(void) {
-    ht* counts = ht_create();
+int main(int argc, char** argv) {
+    int flags = 0;
+    bool time_iteration = false;
+    bool show_memory = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0) {
+            flags |= HT_ORDERED;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            flags |= HT_COMPACT;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            time_iteration = true;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            show_memory = true;
+        } else {
+            fprintf(stderr, "usage: stats [-o | -c] [-i] [-m] <words\n");
+            return 1;
+        }
+    }
+
+    ht* counts = ht_create_flags(flags);
     if (counts == NULL) {
         exit_nomem();
     }
@@ -96,6 +196,60 @@ int main(void) {
         }
     }
 
+    // Time iteration passes (before the values are freed below).
+    double iterate_ms = 0;
+    int runs = 10;
+    if (time_iteration) {
+        size_t total = 0;
+        clock_t start = clock();
+        for (int run = 0; run < runs; run++) {
+            hti it = ht_iterator(counts);
+            while (ht_next(&it)) {
+                total += *(int*)it.value;
+            }
+        }
+        clock_t end = clock();
+        iterate_ms = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+        if (total == 0) {
+            return 1;  // make sure the loop isn't optimized away
+        }
+    }
+
+    // Time get passes (over copies of the keys, as the table's own keys
+    // may be in cache).
+    double get_ms = 0;
+    if (show_memory) {
+        char** keys = malloc(ht_length(counts) * sizeof(char*));
+        if (keys == NULL) {
+            exit_nomem();
+        }
+        size_t num_keys = 0;
+        hti it = ht_iterator(counts);
+        while (ht_next(&it)) {
+            keys[num_keys] = strdup(it.key);
+            if (keys[num_keys] == NULL) {
+                exit_nomem();
+            }
+            num_keys++;
+        }
+        size_t total = 0;
+        clock_t start = clock();
+        for (int run = 0; run < runs; run++) {
+            for (size_t i = 0; i < num_keys; i++) {
+                total += ht_get(counts, keys[i]) != NULL;
+            }
+        }
+        clock_t end = clock();
+        get_ms = (double)(end - start) / CLOCKS_PER_SEC * 1000;
+        if (total == 0) {
+            return 1;  // make sure the loop isn't optimized away
+        }
+        for (size_t i = 0; i < num_keys; i++) {
+            free(keys[i]);
+        }
+        free(keys);
+    }
+
     // Calculate average probe length.
     hti it = ht_iterator(counts);
     size_t total_probes = 0;
@@ -106,6 +260,17 @@ int main(void) {
 
     printf("len=%lu cap=%lu avgprobe=%.3f\n",
         ht_length(counts), counts->capacity, (double)total_probes / ht_length(counts));
+    if (time_iteration) {
+        printf("iterate %d runs: %.03fms\n", runs, iterate_ms);
+    }
+    if (show_memory) {
+        size_t bytes = ht_memory(counts);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        printf("mem=%lu bytes (%.1f per key) maxrss=%.1fMB\n", bytes,
+            (double)bytes / ht_length(counts), (double)usage.ru_maxrss / 1024);
+        printf("get %d runs: %.03fms\n", runs, get_ms);
+    }
 
     ht_destroy(counts);
     return 0;
@@ -2,11 +2,23 @@
 
 set -e
 
-gcc -Wall -O2 -o perfget-c samples/perfget.c ht.c
+# Pin the hash seed so iteration order (and so output) is repeatable.
+export HT_SEED=0
+
+gcc -Wall -O2 -o perfget-c samples/perfget.c ht.c ht64.c
 go build -o perfget-go samples/perfget.go
 gcc -Wall -O2 -o perfset-c samples/perfset.c ht.c
 go build -o perfset-go samples/perfset.go
 gcc -O2 -Wall -o perflbh samples/perflbh.c ht.c
+gcc -Wall -O2 -o perfclear samples/perfclear.c ht.c
+gcc -Wall -O2 -o parcount samples/parcount.c ht.c -lpthread
+gcc -Wall -O2 -o perftok samples/perftok.c samples/tokenize.c ht.c
+gcc -Wall -O2 -o perfcache samples/perfcache.c htcache.c ht.c -lm
+gcc -Wall -O2 -o perfshard samples/perfshard.c htshard.c ht.c -lpthread
+gcc -Wall -O2 -o perfrcu samples/perfrcu.c htrcu.c ht.c -lpthread
+gcc -Wall -O2 -o perfintern samples/perfintern.c samples/tokenize.c ht.c
+gcc -Wall -O2 -o perfcount samples/perfcount.c ht.c
+gcc -Wall -O2 -o perfmerge samples/perfmerge.c ht.c
 
 gcc -Wall -O2 -o lsearch samples/lsearch.c && ./lsearch >samples/output/lsearch.txt
 
@@ -15,12 +27,19 @@ gcc -Wall -O2 -o bsearch samples/bsearch.c && ./bsearch >samples/output/bsearch.
 gcc -Wall -O2 -o demo samples/demo.c ht.c
 echo 'foo bar the bar bar bar the' | ./demo >samples/output/demo.txt
 
+gcc -Wall -O2 -o wcount samples/wcount.c ht.c -lpthread
+echo 'foo bar the bar bar bar the' | ./wcount | diff - samples/output/demo.txt
+
 gcc -Wall -O2 -o dump samples/dump.c ht.c && ./dump >samples/output/dump.txt
 
+gcc -Wall -O2 -o bulk samples/bulk.c ht.c && ./bulk >samples/output/bulk.txt
+
 python3 samples/gensimilar.py 466550 >samples/similar.txt
 gcc -O2 -Wall -o stats samples/stats.c ht.c
 ./stats <samples/words.txt >samples/output/stats-words.txt
 ./stats <samples/similar.txt >samples/output/stats-similar.txt
+./stats -o <samples/similar.txt >samples/output/stats-similar-ordered.txt
+./stats -c <samples/similar.txt >samples/output/stats-similar-compact.txt
 
 git diff --exit-code samples/output/*
 echo 'All good!'
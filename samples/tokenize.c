@@ -0,0 +1,112 @@
+// Whitespace tokenizer that scans 64 bytes at a time using SIMD.
+
+#include "tokenize.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Return 64-bit mask with bit i set if p[i] is whitespace (<= ' ').
+static uint64_t space_mask(const char* p) {
+#if defined(__AVX2__)
+    // Bytes <= ' ' (unsigned) are the ones where min(byte, ' ') == byte.
+    __m256i limit = _mm256_set1_epi8(' ');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(p + 32));
+    uint32_t lo_mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(lo, limit), lo));
+    uint32_t hi_mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(_mm256_min_epu8(hi, limit), hi));
+    return (uint64_t)lo_mask | ((uint64_t)hi_mask << 32);
+#elif defined(__SSE2__)
+    // Same as above, but 16 bytes at a time.
+    __m128i limit = _mm_set1_epi8(' ');
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        uint64_t m = (uint64_t)(uint16_t)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_min_epu8(v, limit), v));
+        mask |= m << i;
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        if ((unsigned char)p[i] <= ' ') {
+            mask |= (uint64_t)1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+// Compute whitespace mask for the tokenizer's current block. Bytes past
+// the end of the input count as whitespace.
+static void load_block(tokenizer* t) {
+    size_t left = t->_size - t->_block;
+    if (left >= 64) {
+        t->_spaces = space_mask(t->_data + t->_block);
+        return;
+    }
+    char tail[64];
+    memset(tail, ' ', sizeof(tail));
+    memcpy(tail, t->_data + t->_block, left);
+    t->_spaces = space_mask(tail);
+}
+
+tokenizer tok_init(const char* data, size_t size) {
+    tokenizer t;
+    t._data = data;
+    t._size = size;
+    t._block = 0;
+    t._pos = 0;
+    t._spaces = ~(uint64_t)0;
+    if (size > 0) {
+        load_block(&t);
+    }
+    return t;
+}
+
+bool tok_next(tokenizer* t, token* tok) {
+    // Find start of token: first non-space bit at or after _pos.
+    size_t start;
+    for (;;) {
+        uint64_t words = ~t->_spaces & (~(uint64_t)0 << (t->_pos - t->_block));
+        if (words != 0) {
+            start = t->_block + (size_t)__builtin_ctzll(words);
+            break;
+        }
+        t->_block += 64;
+        if (t->_block >= t->_size) {
+            t->_pos = t->_block;
+            t->_spaces = ~(uint64_t)0;
+            return false;
+        }
+        t->_pos = t->_block;
+        load_block(t);
+    }
+
+    // Find end of token: first space bit after start. As bytes past the
+    // end count as spaces, this always ends in the last block.
+    t->_pos = start;
+    size_t end;
+    for (;;) {
+        uint64_t spaces = t->_spaces & (~(uint64_t)0 << (t->_pos - t->_block));
+        if (spaces != 0) {
+            end = t->_block + (size_t)__builtin_ctzll(spaces);
+            break;
+        }
+        t->_block += 64;
+        t->_pos = t->_block;
+        load_block(t);
+    }
+
+    tok->start = t->_data + start;
+    tok->length = end - start;
+    t->_pos = end;
+    return true;
+}
@@ -0,0 +1,36 @@
+// Whitespace tokenizer that scans 64 bytes at a time using SIMD.
+
+#ifndef _TOKENIZE_H
+#define _TOKENIZE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Token found by tok_next: a slice of the input, not NUL-terminated.
+typedef struct {
+    const char* start;
+    size_t length;
+} token;
+
+// Tokenizer structure: create with tok_init, iterate with tok_next.
+typedef struct {
+    // Don't use these fields directly.
+    const char* _data;  // input being tokenized
+    size_t _size;       // size of input in bytes
+    size_t _block;      // offset of current 64-byte block
+    uint64_t _spaces;   // bit i set if byte _block+i is whitespace
+    size_t _pos;        // offset to continue scanning from
+} tokenizer;
+
+// Return tokenizer over size bytes of data. Tokens are separated by
+// whitespace, which is any byte <= ' ' (including NUL).
+tokenizer tok_init(const char* data, size_t size);
+
+// Move to next token, set *tok to it, and return true. If there are no
+// more tokens, return false. The byte after a token is always either
+// whitespace or the end of the input, so if the input is writable the
+// caller may overwrite it with a NUL to pass the token to ht_set.
+bool tok_next(tokenizer* t, token* tok);
+
+#endif // _TOKENIZE_H
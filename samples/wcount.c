@@ -0,0 +1,373 @@
+// Streaming, multithreaded word count with sharded aggregation
+
+/*
+
+$ gcc -O2 -Wall -o wcount samples/wcount.c ht.c -lpthread
+$ echo 'foo bar the bar bar bar the' | ./wcount
+foo 1
+bar 4
+the 2
+3
+
+Output is the same as demo.c's for the same input and HT_SEED (words
+are split on whitespace and cut into pieces of at most 100 bytes, like
+its scanf).
+Input is read in batches; each batch is split into one chunk per thread
+at whitespace, and each thread counts its chunk into its own tables,
+one table per shard (picked by the word's hash). When the input is
+done, each shard's tables are merged in parallel. Finally words are
+inserted into one table in order of first occurrence, so it ends up
+laid out exactly like demo.c's table, and printed.
+
+Use -t to set the number of threads (default is one per CPU) and -v to
+report timings and throughput on stderr, for example:
+
+$ for t in 1 2 4 8; do ./wcount -v -t $t big.txt >/dev/null; done
+
+*/
+
+#include "../ht.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+void exit_nomem(void) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+}
+
+#define MAX_WORD 100  // same limit as demo.c's scanf("%100s")
+#define MAX_THREADS 64
+#define CHUNK_SIZE (8 * 1024 * 1024)  // bytes per thread in each batch
+
+// Value stored in the count tables.
+typedef struct {
+    size_t count;
+    size_t first;  // input offset of first occurrence
+} word_info;
+
+// Per-thread counting state.
+typedef struct {
+    ht* shards[MAX_THREADS];  // this thread's table for each shard
+    size_t num_shards;
+    char* start;              // chunk to count (ends with whitespace,
+    char* end;                // or at the end of the input)
+    size_t offset;            // input offset of start
+} counter;
+
+uint64_t shard_seed;  // seed for ht_hash when picking a word's shard
+
+// Same characters as isspace() in the C locale.
+static inline int is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+void count_word(counter* c, const char* word, size_t offset) {
+    // Use the high bits for the shard, as ht uses the low bits.
+    ht* table = c->shards[(ht_hash(shard_seed, word) >> 32) % c->num_shards];
+    word_info* info = ht_get(table, word);
+    if (info != NULL) {
+        info->count++;
+        return;
+    }
+    info = malloc(sizeof(word_info));
+    if (info == NULL) {
+        exit_nomem();
+    }
+    info->count = 1;
+    info->first = offset;
+    if (ht_set(table, word, info) == NULL) {
+        exit_nomem();
+    }
+}
+
+void* count_chunk(void* arg) {
+    counter* c = (counter*)arg;
+    char* p = c->start;
+    while (p < c->end) {
+        // Skip whitespace.
+        while (p < c->end && is_space(*p)) {
+            p++;
+        }
+        if (p >= c->end) {
+            break;
+        }
+
+        // Find end of word.
+        char* word = p;
+        while (p < c->end && !is_space(*p)) {
+            p++;
+        }
+
+        // Count long words in MAX_WORD pieces, like scanf would.
+        while (p - word > MAX_WORD) {
+            char piece[MAX_WORD + 1];
+            memcpy(piece, word, MAX_WORD);
+            piece[MAX_WORD] = 0;
+            count_word(c, piece, c->offset + (word - c->start));
+            word += MAX_WORD;
+        }
+
+        // This overwrites the whitespace after the word (or the spare
+        // byte after the input), which is still in this chunk.
+        *p = 0;
+        count_word(c, word, c->offset + (word - c->start));
+        p++;
+    }
+    return NULL;
+}
+
+counter counters[MAX_THREADS];
+size_t num_threads;
+
+// Count words in data[0:size] using all threads, where offset is the
+// input offset of data. Data must end with whitespace or be the end of
+// the input (and have a spare byte after it).
+void count_batch(char* data, size_t size, size_t offset) {
+    pthread_t threads[MAX_THREADS];
+    char* end = data + size;
+    char* start = data;
+    for (size_t t = 0; t < num_threads; t++) {
+        // Split at first whitespace at or after the even split point.
+        char* split = data + size * (t + 1) / num_threads;
+        if (split < start) {
+            split = start;
+        }
+        while (split < end && !is_space(*split)) {
+            split++;
+        }
+        if (split < end) {
+            split++;
+        }
+        counters[t].start = start;
+        counters[t].end = split;
+        counters[t].offset = offset + (start - data);
+        if (pthread_create(&threads[t], NULL, count_chunk, &counters[t]) != 0) {
+            fprintf(stderr, "can't create thread\n");
+            exit(1);
+        }
+        start = split;
+    }
+    for (size_t t = 0; t < num_threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+// Combine counts for a word seen by two threads (for ht_merge_move).
+void* combine_info(const char* key, void* dst_value, void* src_value,
+                   void* arg) {
+    word_info* existing = dst_value;
+    word_info* info = src_value;
+    existing->count += info->count;
+    if (info->first < existing->first) {
+        existing->first = info->first;
+    }
+    free(info);
+    return existing;
+}
+
+// Merge all threads' tables for one shard into thread 0's table.
+void* merge_shard(void* arg) {
+    size_t shard = (size_t)arg;
+    ht* dst = counters[0].shards[shard];
+    for (size_t t = 1; t < num_threads; t++) {
+        // Moves keys new to dst rather than copying them, and destroys src.
+        if (!ht_merge_move(dst, counters[t].shards[shard], combine_info,
+                           NULL)) {
+            exit_nomem();
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    const char* key;
+    word_info* info;
+} word_entry;
+
+int compare_first(const void* a, const void* b) {
+    size_t fa = ((const word_entry*)a)->info->first;
+    size_t fb = ((const word_entry*)b)->info->first;
+    return fa < fb ? -1 : fa > fb;
+}
+
+// Return wall-clock time in seconds (clock() adds up all threads).
+double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    num_threads = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    int verbose = 0;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            num_threads = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: wcount [-t threads] [-v] [file]\n");
+            return 1;
+        }
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if (num_threads > MAX_THREADS) {
+        num_threads = MAX_THREADS;
+    }
+
+    int fd = 0;
+    if (path != NULL) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "can't open file: %s\n", path);
+            return 1;
+        }
+    }
+
+    // Each shard's tables use the same hash function as thread 0's, as
+    // they'll be merged into it (see ht_create_like).
+    for (size_t t = 0; t < num_threads; t++) {
+        counters[t].num_shards = num_threads;
+        for (size_t s = 0; s < num_threads; s++) {
+            if (t == 0) {
+                counters[t].shards[s] = ht_create();
+            } else {
+                counters[t].shards[s] = ht_create_like(counters[0].shards[s]);
+            }
+            if (counters[t].shards[s] == NULL) {
+                exit_nomem();
+            }
+        }
+    }
+
+    // Read input in batches, counting everything up to the last
+    // whitespace, and carrying the partial word over to the next batch.
+    double start = now();
+    size_t buf_size = num_threads * CHUNK_SIZE;
+    char* buf = malloc(buf_size + 1);
+    if (buf == NULL) {
+        exit_nomem();
+    }
+    size_t len = 0;
+    size_t offset = 0;
+    for (;;) {
+        ssize_t n = read(fd, buf + len, buf_size - len);
+        if (n < 0) {
+            fprintf(stderr, "read error\n");
+            return 1;
+        }
+        len += (size_t)n;
+        if (n == 0) {
+            count_batch(buf, len, offset);
+            offset += len;
+            break;
+        }
+        if (len < buf_size) {
+            continue;
+        }
+        size_t cut = len;
+        while (cut > 0 && !is_space(buf[cut - 1])) {
+            cut--;
+        }
+        if (cut == 0) {
+            // No whitespace in whole buffer, grow it and read more.
+            buf_size *= 2;
+            buf = realloc(buf, buf_size + 1);
+            if (buf == NULL) {
+                exit_nomem();
+            }
+            continue;
+        }
+        count_batch(buf, cut, offset);
+        memmove(buf, buf + cut, len - cut);
+        offset += cut;
+        len -= cut;
+    }
+    free(buf);
+    double counted = now();
+
+    // Merge shards in parallel.
+    pthread_t threads[MAX_THREADS];
+    for (size_t s = 0; s < num_threads; s++) {
+        if (pthread_create(&threads[s], NULL, merge_shard, (void*)s) != 0) {
+            fprintf(stderr, "can't create thread\n");
+            return 1;
+        }
+    }
+    for (size_t s = 0; s < num_threads; s++) {
+        pthread_join(threads[s], NULL);
+    }
+    double merged = now();
+
+    // Sort all words by first occurrence.
+    size_t num_words = 0;
+    for (size_t s = 0; s < num_threads; s++) {
+        num_words += ht_length(counters[0].shards[s]);
+    }
+    word_entry* words = malloc(num_words * sizeof(word_entry) + 1);
+    if (words == NULL) {
+        exit_nomem();
+    }
+    size_t i = 0;
+    for (size_t s = 0; s < num_threads; s++) {
+        hti it = ht_iterator(counters[0].shards[s]);
+        while (ht_next(&it)) {
+            words[i].key = it.key;
+            words[i].info = it.value;
+            i++;
+        }
+    }
+    qsort(words, num_words, sizeof(word_entry), compare_first);
+
+    // Insert into one table in that order, giving demo.c's layout.
+    ht* counts = ht_create();
+    if (counts == NULL) {
+        exit_nomem();
+    }
+    for (i = 0; i < num_words; i++) {
+        if (ht_set(counts, words[i].key, words[i].info) == NULL) {
+            exit_nomem();
+        }
+    }
+
+    // Print out words and frequencies, freeing values as we go.
+    hti it = ht_iterator(counts);
+    while (ht_next(&it)) {
+        word_info* info = it.value;
+        printf("%s %lu\n", it.key, info->count);
+        free(info);
+    }
+
+    // Show the number of unique words.
+    printf("%d\n", (int)ht_length(counts));
+    double printed = now();
+
+    if (verbose) {
+        double gb = (double)offset / 1e9;
+        fprintf(stderr, "%lu threads, %lu bytes, %lu unique words\n",
+            num_threads, offset, num_words);
+        fprintf(stderr, "count: %.03fs (%.03f GB/s), merge: %.03fs, "
+            "output: %.03fs, total: %.03fs (%.03f GB/s)\n",
+            counted - start, gb / (counted - start), merged - counted,
+            printed - merged, printed - start, gb / (printed - start));
+    }
+
+    ht_destroy(counts);
+    for (size_t s = 0; s < num_threads; s++) {
+        ht_destroy(counters[0].shards[s]);
+    }
+    free(words);
+    return 0;
+}